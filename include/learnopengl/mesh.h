@@ -7,11 +7,15 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <learnopengl/shader.h>
+#include <GpuMemory.h>
 
 #include <string>
 #include <vector>
 using namespace std;
 
+// first of the four attribute locations holding the per-instance model matrix
+#define INSTANCE_MATRIX_LOCATION 5
+
 struct Vertex {
     // position
     glm::vec3 Position;
@@ -38,6 +42,9 @@ public:
     vector<unsigned int> indices;
     vector<Texture>      textures;
     unsigned int VAO;
+    // object space bounding box, computed once at import
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
 
     // constructor
     Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
@@ -46,12 +53,24 @@ public:
         this->indices = indices;
         this->textures = textures;
 
+        computeBounds();
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
         setupMesh();
     }
 
     // render the mesh
     void Draw(Shader &shader) 
+    {
+        bindTextures(shader);
+        drawGeometry();
+        glBindVertexArray(0);
+
+        // always good practice to set everything back to defaults once configured.
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // bind the mesh's textures and point the shader's samplers at them
+    void bindTextures(Shader &shader)
     {
         // bind appropriate textures
         unsigned int diffuseNr  = 1;
@@ -78,19 +97,76 @@ public:
             // and finally bind the texture
             glBindTexture(GL_TEXTURE_2D, textures[i].id);
         }
-        
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    }
+
+    // render instanceCount copies of the mesh in one call,
+    // instanceBuffer holds one mat4 model matrix per instance
+    void DrawInstanced(Shader &shader, unsigned int instanceBuffer, unsigned int instanceCount)
+    {
+        bindTextures(shader);
+        setInstanceBuffer(instanceBuffer);
+        glDrawElementsInstanced(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0, instanceCount);
         glBindVertexArray(0);
 
-        // always good practice to set everything back to defaults once configured.
         glActiveTexture(GL_TEXTURE0);
     }
 
+    // issue the draw call only; the caller is responsible for textures and unbinding the VAO
+    void drawGeometry()
+    {
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    }
+
+    // true if both meshes bind exactly the same textures in the same order
+    bool sameTextures(const Mesh &other) const
+    {
+        if (textures.size() != other.textures.size())
+            return false;
+        for (unsigned int i = 0; i < textures.size(); i++)
+            if (textures[i].id != other.textures[i].id || textures[i].type != other.textures[i].type)
+                return false;
+        return true;
+    }
+
 private:
     // render data 
     unsigned int VBO, EBO;
+    // buffer the instance matrix attributes currently point at
+    unsigned int instanceVBO = 0;
+
+    // binds the VAO and, if the buffer changed, points the instance attributes at it
+    void setInstanceBuffer(unsigned int buffer)
+    {
+        glBindVertexArray(VAO);
+        if (buffer == instanceVBO)
+            return;
+        instanceVBO = buffer;
+
+        // a mat4 attribute takes four vec4 locations
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            glEnableVertexAttribArray(INSTANCE_MATRIX_LOCATION + i);
+            glVertexAttribPointer(INSTANCE_MATRIX_LOCATION + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(i * sizeof(glm::vec4)));
+            glVertexAttribDivisor(INSTANCE_MATRIX_LOCATION + i, 1);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void computeBounds()
+    {
+        boundsMin = glm::vec3(0.0f);
+        boundsMax = glm::vec3(0.0f);
+        if (vertices.empty())
+            return;
+        boundsMin = boundsMax = vertices[0].Position;
+        for (unsigned int i = 1; i < vertices.size(); i++)
+        {
+            boundsMin = glm::min(boundsMin, vertices[i].Position);
+            boundsMax = glm::max(boundsMax, vertices[i].Position);
+        }
+    }
 
     // initializes all the buffer objects/arrays
     void setupMesh()
@@ -110,6 +186,8 @@ private:
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        GpuMemory::track(GL_BUFFER, VBO, GPU_MEMORY_MESH, vertices.size() * sizeof(Vertex), "mesh vertices");
+        GpuMemory::track(GL_BUFFER, EBO, GPU_MEMORY_MESH, indices.size() * sizeof(unsigned int), "mesh indices");
 
         // set the vertex attribute pointers
         // vertex Positions
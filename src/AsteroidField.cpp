@@ -0,0 +1,82 @@
+#include "AsteroidField.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include "GpuMemory.h"
+#include "JobSystem.h"
+
+//largest random rock scale
+static const float ROCK_MAX_SCALE = 2.5f;
+static const float PLANET_SCALE = 20.0f;
+
+AsteroidField::AsteroidField(float radius, float spread) : radius(radius), spread(spread) {
+	rock = new Model(FileSystem::getPath("resources/objects/rock/rock.obj"));
+	planet = new Model(FileSystem::getPath("resources/objects/planet/planet.obj"));
+	glGenBuffers(1, &instanceBuffer);
+}
+
+AsteroidField::~AsteroidField() {
+	GpuMemory::untrack(GL_BUFFER, instanceBuffer);
+	glDeleteBuffers(1, &instanceBuffer);
+	delete rock;
+	delete planet;
+}
+
+void AsteroidField::setCount(unsigned int count, const glm::mat4& fieldTransform) {
+	this->count = count;
+
+	//same seed every time, so a given count always gives the same field.
+	//rand() is drawn in order here, the matrices are built on the workers
+	srand(559);
+	vector<int> random(count * 5);
+	for (unsigned int i = 0; i < count * 5; i++)
+		random[i] = rand();
+
+	vector<glm::mat4> matrices(count);
+	JobSystem::parallelFor(0, (int)count, 4096, [&](int first, int last) {
+		for (int i = first; i < last; i++) {
+			const int* r = &random[i * 5];
+			//place the rock on the ring, then displace it randomly
+			float angle = (float)i / (float)count * 360.0f;
+			float displacement = (r[0] % (int)(2 * spread * 100)) / 100.0f - spread;
+			float x = sin(glm::radians(angle)) * radius + displacement;
+			displacement = (r[1] % (int)(2 * spread * 100)) / 100.0f - spread;
+			float y = displacement * 0.4f; //keep the ring flat
+			displacement = (r[2] % (int)(2 * spread * 100)) / 100.0f - spread;
+			float z = cos(glm::radians(angle)) * radius + displacement;
+
+			glm::mat4 model = glm::translate(fieldTransform, glm::vec3(x, y, z));
+			float scale = (r[3] % 200) / 100.0f + ROCK_MAX_SCALE - 2.0f;
+			model = glm::scale(model, glm::vec3(scale));
+			float rotation = (float)(r[4] % 360);
+			model = glm::rotate(model, glm::radians(rotation), glm::vec3(0.4f, 0.6f, 0.8f));
+			matrices[i] = model;
+		}
+	});
+
+	//the field is static, so the matrices go up once
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, matrices.size() * sizeof(glm::mat4), matrices.data(), GL_STATIC_DRAW);
+	GpuMemory::track(GL_BUFFER, instanceBuffer, GPU_MEMORY_BUFFER, matrices.size() * sizeof(glm::mat4), "asteroid instances");
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void AsteroidField::drawRocks(Shader& shader) {
+	if (!count)
+		return;
+	shader.use();
+	rock->DrawInstanced(shader, instanceBuffer, count);
+}
+
+glm::mat4 AsteroidField::planetMatrix(const glm::mat4& fieldTransform) const {
+	return glm::scale(fieldTransform, glm::vec3(PLANET_SCALE));
+}
+
+glm::vec3 AsteroidField::boundsMin() const {
+	float rockSize = ROCK_MAX_SCALE * glm::length(rock->boundsMax - rock->boundsMin);
+	float horizontal = radius + spread + rockSize;
+	float vertical = glm::max(spread * 0.4f + rockSize, PLANET_SCALE * planet->boundsMax.y);
+	return glm::vec3(-horizontal, -vertical, -horizontal);
+}
+
+glm::vec3 AsteroidField::boundsMax() const {
+	return -boundsMin();
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include<iostream>
+#include<vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <learnopengl/model.h>
+#include <learnopengl/filesystem.h>
+#include <learnopengl/shader_m.h>
+
+using namespace std;
+
+//range of the asteroid count hotkeys
+#define ASTEROID_MIN_COUNT 10000
+#define ASTEROID_MAX_COUNT 1000000
+
+//A planet with a ring of rocks around it, a scale test for instanced drawing:
+//every rock is one instance of the same model, so the field costs one draw call
+//per rock mesh no matter how many rocks there are.
+class AsteroidField
+{
+public:
+	AsteroidField(float radius, float spread);
+	~AsteroidField();
+
+	//scatter count rocks around the planet, fieldTransform places the whole field
+	void setCount(unsigned int count, const glm::mat4& fieldTransform);
+	//the shader reads the instance matrix at INSTANCE_MATRIX_LOCATION
+	void drawRocks(Shader& shader);
+	//model matrix of the planet inside the field
+	glm::mat4 planetMatrix(const glm::mat4& fieldTransform) const;
+
+	//object space bounds of the whole field
+	glm::vec3 boundsMin() const;
+	glm::vec3 boundsMax() const;
+
+	Model* rock = nullptr;
+	Model* planet = nullptr;
+
+	unsigned int count = 0;
+	float radius;	//distance of the ring from the planet
+	float spread;	//how far rocks stray from the ring
+
+private:
+	GLuint instanceBuffer = 0;
+};
@@ -0,0 +1,216 @@
+#include "AsyncReadback.h"
+#include "GpuMemory.h"
+#include <cstring>
+
+size_t readbackPixelSize(GLenum format, GLenum type) {
+	size_t components;
+	switch (format) {
+	case GL_RED:
+	case GL_DEPTH_COMPONENT:	components = 1; break;
+	case GL_RG:					components = 2; break;
+	case GL_RGB:
+	case GL_BGR:				components = 3; break;
+	default:					components = 4; break;
+	}
+
+	size_t bytes;
+	switch (type) {
+	case GL_UNSIGNED_BYTE:
+	case GL_BYTE:			bytes = 1; break;
+	case GL_HALF_FLOAT:
+	case GL_UNSIGNED_SHORT:
+	case GL_SHORT:			bytes = 2; break;
+	default:				bytes = 4; break;
+	}
+	return components * bytes;
+}
+
+AsyncReadback::AsyncReadback() {
+}
+
+AsyncReadback::~AsyncReadback() {
+	for (Slot* slot : slots) {
+		if (slot->fence)
+			glDeleteSync(slot->fence);
+		GpuMemory::untrack(GL_BUFFER, slot->pbo);
+		glDeleteBuffers(1, &slot->pbo);
+		delete slot;
+	}
+}
+
+ReadbackTicket AsyncReadback::request(GLuint fbo, GLenum attachment, int x, int y, int width, int height,
+	GLenum format, GLenum type, ReadbackCallback callback) {
+	Slot* slot = freeSlot();
+	if (!slot) {
+		if (!fullReported) {
+			cout << "AsyncReadback: " << READBACK_MAX_SLOTS << " reads in flight, request refused" << endl;
+			fullReported = true;
+		}
+		return 0;
+	}
+
+	GLsizeiptr size = (GLsizeiptr)width * height * readbackPixelSize(format, type);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+	if (slot->capacity < size) {
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+		slot->capacity = size;
+		GpuMemory::track(GL_BUFFER, slot->pbo, GPU_MEMORY_BUFFER, size, "readback PBO");
+	}
+
+	//rows are tightly packed, whatever the width
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+	if (attachment != GL_DEPTH_ATTACHMENT)
+		glReadBuffer(attachment);
+	//with a pack buffer bound the pointer is an offset, the call returns right away
+	glReadPixels(x, y, width, height, format, type, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+	slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot->state = SLOT_PENDING;
+	slot->callback = callback;
+	slot->result = ReadbackResult();
+	slot->result.ticket = nextTicket++;
+	if (nextTicket == 0)
+		nextTicket = 1;
+	slot->result.width = width;
+	slot->result.height = height;
+	slot->result.format = format;
+	slot->result.type = type;
+	slot->result.size = (size_t)size;
+	return slot->result.ticket;
+}
+
+ReadbackTicket AsyncReadback::requestColor(FrameBuffer& fbo, int x, int y, int width, int height,
+	GLenum format, GLenum type, ReadbackCallback callback) {
+	if (fbo.getMsaa() > 0)
+		fbo.blitColorTo(fbo.getResolveId());
+	return request(fbo.getResolveId(), GL_COLOR_ATTACHMENT0, x, y, width, height, format, type, callback);
+}
+
+ReadbackTicket AsyncReadback::requestDepth(FrameBuffer& fbo, int x, int y, int width, int height,
+	ReadbackCallback callback) {
+	if (fbo.getMsaa() > 0)
+		fbo.blitDepthTo(fbo.getResolveId());
+	return request(fbo.getResolveId(), GL_DEPTH_ATTACHMENT, x, y, width, height, GL_DEPTH_COMPONENT, GL_FLOAT, callback);
+}
+
+void AsyncReadback::poll() {
+	//by index, a callback may queue a new request
+	for (size_t i = 0; i < slots.size(); i++) {
+		Slot* slot = slots[i];
+		if (slot->state != SLOT_PENDING)
+			continue;
+		//timeout 0: only ask, the flush bit makes sure the fence reaches the GPU
+		GLenum status = glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+			complete(*slot);
+	}
+}
+
+bool AsyncReadback::isReady(ReadbackTicket ticket) const {
+	const Slot* slot = findSlot(ticket);
+	return slot && slot->state == SLOT_READY;
+}
+
+bool AsyncReadback::fetch(ReadbackTicket ticket, ReadbackResult& result) const {
+	const Slot* slot = findSlot(ticket);
+	if (!slot || slot->state != SLOT_READY)
+		return false;
+	result = slot->result;
+	return true;
+}
+
+void AsyncReadback::release(ReadbackTicket ticket) {
+	Slot* slot = findSlot(ticket);
+	if (!slot)
+		return;
+	if (slot->fence) {
+		glDeleteSync(slot->fence);
+		slot->fence = 0;
+	}
+	slot->state = SLOT_FREE;
+	slot->callback = nullptr;
+}
+
+bool AsyncReadback::wait(ReadbackTicket ticket) {
+	Slot* slot = findSlot(ticket);
+	if (!slot)
+		return false;
+	if (slot->state == SLOT_PENDING) {
+		GLenum status = glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000));
+		if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) {
+			cout << "AsyncReadback: wait for ticket " << ticket << " failed" << endl;
+			return false;
+		}
+		complete(*slot);
+	}
+	return true;
+}
+
+int AsyncReadback::getPendingCount() const {
+	int count = 0;
+	for (const Slot* slot : slots)
+		if (slot->state == SLOT_PENDING)
+			count++;
+	return count;
+}
+
+AsyncReadback::Slot* AsyncReadback::findSlot(ReadbackTicket ticket) {
+	for (Slot* slot : slots)
+		if (slot->state != SLOT_FREE && slot->result.ticket == ticket)
+			return slot;
+	return nullptr;
+}
+
+const AsyncReadback::Slot* AsyncReadback::findSlot(ReadbackTicket ticket) const {
+	for (const Slot* slot : slots)
+		if (slot->state != SLOT_FREE && slot->result.ticket == ticket)
+			return slot;
+	return nullptr;
+}
+
+AsyncReadback::Slot* AsyncReadback::freeSlot() {
+	for (Slot* slot : slots)
+		if (slot->state == SLOT_FREE)
+			return slot;
+	if (slots.size() >= READBACK_MAX_SLOTS)
+		return nullptr;
+
+	Slot* slot = new Slot();
+	glGenBuffers(1, &slot->pbo);
+	slots.push_back(slot);
+	return slot;
+}
+
+void AsyncReadback::complete(Slot& slot) {
+	glDeleteSync(slot.fence);
+	slot.fence = 0;
+
+	slot.pixels.resize(slot.result.size);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+	void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.result.size, GL_MAP_READ_BIT);
+	if (!mapped) {
+		cout << "AsyncReadback: could not map the pixels of ticket " << slot.result.ticket << endl;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		release(slot.result.ticket);
+		return;
+	}
+	memcpy(slot.pixels.data(), mapped, slot.result.size);
+	glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	slot.result.data = slot.pixels.data();
+	slot.state = SLOT_READY;
+	fullReported = false;
+
+	if (slot.callback) {
+		ReadbackCallback callback = slot.callback;
+		ReadbackResult result = slot.result;
+		callback(result);
+		//the pixels belong to the callback only, the slot is free again
+		release(result.ticket);
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include<iostream>
+#include<vector>
+#include<functional>
+
+#include <glad/glad.h>
+
+#include "FrameBuffer.h"
+
+using namespace std;
+
+//pixel buffers a request can use at the same time, more requests are refused
+#define READBACK_MAX_SLOTS 16
+
+//handle of a queued readback, 0 if the request was refused
+typedef unsigned int ReadbackTicket;
+
+//pixels of a finished readback, data is only valid inside the callback or until release()
+struct ReadbackResult
+{
+	ReadbackTicket ticket = 0;
+	int width = 0;
+	int height = 0;
+	GLenum format = GL_RGBA;
+	GLenum type = GL_UNSIGNED_BYTE;
+	const void* data = nullptr;
+	size_t size = 0;
+};
+
+typedef function<void(const ReadbackResult&)> ReadbackCallback;
+
+//Reads framebuffer regions without stalling the pipeline.
+//request() issues glReadPixels into a pixel pack buffer and fences it; nothing waits.
+//poll() (once per frame) maps the buffers whose fence has signaled, usually one or two
+//frames later, and either runs the callback of the request or keeps the pixels
+//for isReady()/fetch().
+class AsyncReadback
+{
+public:
+	AsyncReadback();
+	~AsyncReadback();
+
+	//read (x, y, width, height) of attachment of framebuffer fbo
+	ReadbackTicket request(GLuint fbo, GLenum attachment, int x, int y, int width, int height,
+		GLenum format, GLenum type, ReadbackCallback callback = nullptr);
+	//same for a FrameBuffer, resolves the multi-sample buffers first
+	ReadbackTicket requestColor(FrameBuffer& fbo, int x, int y, int width, int height,
+		GLenum format, GLenum type, ReadbackCallback callback = nullptr);
+	ReadbackTicket requestDepth(FrameBuffer& fbo, int x, int y, int width, int height,
+		ReadbackCallback callback = nullptr);
+
+	//check the fences without blocking, copy out and dispatch what is done
+	void poll();
+
+	bool isReady(ReadbackTicket ticket) const;
+	//pixels of a ready request without a callback, keeps them until release()
+	bool fetch(ReadbackTicket ticket, ReadbackResult& result) const;
+	void release(ReadbackTicket ticket);
+	//block until the request is done, for code that has to have the pixels now
+	bool wait(ReadbackTicket ticket);
+
+	int getPendingCount() const;
+
+private:
+	enum SlotState { SLOT_FREE, SLOT_PENDING, SLOT_READY };
+
+	struct Slot
+	{
+		GLuint pbo = 0;
+		GLsizeiptr capacity = 0;
+		GLsync fence = 0;
+		SlotState state = SLOT_FREE;
+		ReadbackResult result;
+		vector<unsigned char> pixels;	//CPU copy once the fence signaled
+		ReadbackCallback callback;
+	};
+
+	Slot* findSlot(ReadbackTicket ticket);
+	const Slot* findSlot(ReadbackTicket ticket) const;
+	Slot* freeSlot();
+	//map the pbo, copy it out and run the callback
+	void complete(Slot& slot);
+
+	vector<Slot*> slots;
+	ReadbackTicket nextTicket = 1;
+	bool fullReported = false;
+};
+
+//bytes per pixel of a glReadPixels format/type pair
+size_t readbackPixelSize(GLenum format, GLenum type);
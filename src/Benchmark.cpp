@@ -0,0 +1,287 @@
+#include "Benchmark.h"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
+
+#include <glm/gtc/constants.hpp>
+
+#include "TrainView.H"
+
+float percentile(vector<float> values, float p) {
+	if (values.empty())
+		return 0.0f;
+	sort(values.begin(), values.end());
+	size_t rank = (size_t)(p / 100.0f * values.size() + 0.5f);
+	rank = min(max(rank, (size_t)1), values.size());
+	return values[rank - 1];
+}
+
+static float mean(const vector<float>& values) {
+	if (values.empty())
+		return 0.0f;
+	double sum = 0;
+	for (float value : values)
+		sum += value;
+	return (float)(sum / values.size());
+}
+
+//still camera looking down at the water
+static BenchmarkKey waterView() {
+	return { 0, glm::vec3(0.0f, 150.0f, 300.0f), -90.0f, -25.0f };
+}
+
+void Benchmark::loadDefault() {
+	scenarios.clear();
+
+	BenchmarkScenario orbit;
+	orbit.name = "orbit";
+	const int orbitKeys = 8;
+	for (int i = 0; i <= orbitKeys; i++) {
+		float angle = glm::two_pi<float>() * i / orbitKeys;
+		glm::vec3 position(300.0f * cos(angle), 150.0f, 300.0f * sin(angle));
+		//yaw faces the origin
+		orbit.camera.push_back({ orbit.frames * i / orbitKeys, position, glm::degrees(angle) + 180.0f, -25.0f });
+	}
+	scenarios.push_back(orbit);
+
+	const char* waveNames[] = { "wave_sine", "wave_heightmap", "wave_interactive" };
+	for (int wave = 1; wave <= 3; wave++) {
+		BenchmarkScenario scenario;
+		scenario.name = waveNames[wave - 1];
+		scenario.waveType = wave;
+		scenario.camera.push_back(waterView());
+		scenarios.push_back(scenario);
+	}
+
+	const char* lightNames[] = { "light_directional", "light_point", "light_spot" };
+	for (int light = 1; light <= 3; light++) {
+		BenchmarkScenario scenario;
+		scenario.name = lightNames[light - 1];
+		scenario.lightType = light;
+		scenario.camera.push_back(waterView());
+		scenarios.push_back(scenario);
+	}
+
+	const char* postNames[] = { "post_pixelation", "post_offset", "post_grayscale" };
+	for (int post = 0; post < 3; post++) {
+		BenchmarkScenario scenario;
+		scenario.name = postNames[post];
+		scenario.pixelation = post == 0;
+		scenario.offset = post == 1;
+		scenario.grayscale = post == 2;
+		scenario.camera.push_back(waterView());
+		scenarios.push_back(scenario);
+	}
+
+	BenchmarkScenario drops;
+	drops.name = "drops";
+	drops.waveType = 3;
+	drops.camera.push_back(waterView());
+	//a fixed walk over the surface, the same on every run
+	for (int frame = 0; frame < drops.frames; frame += 10) {
+		float t = frame / (float)drops.frames;
+		drops.drops.push_back({ frame, glm::vec2(0.5f + 0.35f * cos(t * 13.0f), 0.5f + 0.35f * sin(t * 7.0f)) });
+	}
+	scenarios.push_back(drops);
+}
+
+bool Benchmark::load(const string& path) {
+	ifstream file(path);
+	if (!file) {
+		cout << "Benchmark: can't open " << path << endl;
+		return false;
+	}
+
+	scenarios.clear();
+	string line;
+	int lineNumber = 0;
+	while (getline(file, line)) {
+		lineNumber++;
+		istringstream tokens(line);
+		string command;
+		if (!(tokens >> command) || command[0] == '#')
+			continue;
+
+		if (command == "scenario") {
+			scenarios.push_back(BenchmarkScenario());
+			tokens >> scenarios.back().name;
+			continue;
+		}
+		if (scenarios.empty()) {
+			cout << "Benchmark: " << path << ":" << lineNumber << ": " << command << " before the first scenario" << endl;
+			return false;
+		}
+
+		BenchmarkScenario& scenario = scenarios.back();
+		bool ok;
+		if (command == "frames")
+			ok = (bool)(tokens >> scenario.frames);
+		else if (command == "warmup")
+			ok = (bool)(tokens >> scenario.warmupFrames);
+		else if (command == "wave")
+			ok = (bool)(tokens >> scenario.waveType);
+		else if (command == "light")
+			ok = (bool)(tokens >> scenario.lightType);
+		else if (command == "post")
+			ok = (bool)(tokens >> scenario.pixelation >> scenario.offset >> scenario.grayscale);
+		else if (command == "camera") {
+			BenchmarkKey key;
+			ok = (bool)(tokens >> key.frame >> key.position.x >> key.position.y >> key.position.z >> key.yaw >> key.pitch);
+			scenario.camera.push_back(key);
+		}
+		else if (command == "drop") {
+			BenchmarkDrop drop;
+			ok = (bool)(tokens >> drop.frame >> drop.uv.x >> drop.uv.y);
+			scenario.drops.push_back(drop);
+		}
+		else
+			ok = false;
+
+		if (!ok) {
+			cout << "Benchmark: " << path << ":" << lineNumber << ": can't read \"" << line << "\"" << endl;
+			return false;
+		}
+	}
+
+	for (BenchmarkScenario& scenario : scenarios) {
+		sort(scenario.camera.begin(), scenario.camera.end(),
+			[](const BenchmarkKey& a, const BenchmarkKey& b) { return a.frame < b.frame; });
+		if (scenario.camera.empty())
+			scenario.camera.push_back(waterView());
+	}
+	return !scenarios.empty();
+}
+
+void Benchmark::apply(const BenchmarkScenario& scenario, int frame, TrainView& view, RenderSettings& settings) const {
+	//every scenario starts from the same water
+	if (frame == 0) {
+		view.simulation->reset();
+		view.firstDraw = true;
+	}
+
+	settings.worldCam = true;
+	settings.topCam = false;
+	settings.trainCam = false;
+	settings.waveType = scenario.waveType;
+	settings.lightType = scenario.lightType;
+	settings.pixelation = scenario.pixelation;
+	settings.offset = scenario.offset;
+	settings.grayscale = scenario.grayscale;
+	settings.finishPasses = true;
+
+	//the warm up holds the first key
+	int pathFrame = max(frame - scenario.warmupFrames, 0);
+	const BenchmarkKey* from = &scenario.camera.front();
+	const BenchmarkKey* to = from;
+	for (const BenchmarkKey& key : scenario.camera) {
+		if (key.frame <= pathFrame)
+			from = to = &key;
+		else {
+			to = &key;
+			break;
+		}
+	}
+	float t = (to->frame > from->frame) ? (pathFrame - from->frame) / (float)(to->frame - from->frame) : 0.0f;
+	view.camera.Position = glm::mix(from->position, to->position, t);
+	view.camera.Yaw = glm::mix(from->yaw, to->yaw, t);
+	view.camera.Pitch = glm::mix(from->pitch, to->pitch, t);
+	//recomputes Front/Right/Up from yaw and pitch
+	view.camera.ProcessMouseMovement(0.0f, 0.0f);
+
+	if (frame >= scenario.warmupFrames) {
+		for (const BenchmarkDrop& drop : scenario.drops)
+			if (drop.frame == pathFrame)
+				view.updateInteractiveHeightMapFBO(1, drop.uv);
+	}
+}
+
+void Benchmark::record(BenchmarkScenario& scenario, float frameMs, const PassTimings& passes, const vector<GpuZoneResult>& gpuZones) const {
+	scenario.frameMs.push_back(frameMs);
+	scenario.passMs.push_back(passes);
+	if (GlCallCounter::isInstalled())
+		scenario.glCalls.push_back(GlCallCounter::getLastFrame());
+	for (const GpuZoneResult& zone : gpuZones) {
+		auto found = find_if(scenario.gpuMs.begin(), scenario.gpuMs.end(),
+			[&zone](const pair<string, vector<float>>& entry) { return entry.first == zone.name; });
+		if (found == scenario.gpuMs.end()) {
+			scenario.gpuMs.push_back(make_pair(string(zone.name), vector<float>()));
+			found = scenario.gpuMs.end() - 1;
+		}
+		found->second.push_back(zone.ms);
+	}
+}
+
+static void writeStats(ofstream& json, const vector<float>& values) {
+	char text[256];
+	snprintf(text, sizeof(text), "{ \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }",
+		mean(values), percentile(values, 50), percentile(values, 95), percentile(values, 99), percentile(values, 100));
+	json << text;
+}
+
+bool Benchmark::writeJson(const string& path, const string& renderer, int width, int height, float deltaTime) const {
+	ofstream json(path);
+	if (!json) {
+		cout << "Benchmark: can't write " << path << endl;
+		return false;
+	}
+
+	json << "{\n";
+	json << "  \"renderer\": \"" << renderer << "\",\n";
+	json << "  \"width\": " << width << ",\n";
+	json << "  \"height\": " << height << ",\n";
+	json << "  \"dt\": " << deltaTime << ",\n";
+	json << "  \"scenarios\": [\n";
+	for (size_t i = 0; i < scenarios.size(); i++) {
+		const BenchmarkScenario& scenario = scenarios[i];
+		json << "    {\n";
+		json << "      \"name\": \"" << scenario.name << "\",\n";
+		json << "      \"frames\": " << scenario.frameMs.size() << ",\n";
+		json << "      \"frame_ms\": ";
+		writeStats(json, scenario.frameMs);
+		json << ",\n";
+		json << "      \"passes\": {\n";
+		for (int pass = 0; pass < STAGE_COUNT; pass++) {
+			vector<float> values;
+			for (const PassTimings& timings : scenario.passMs)
+				values.push_back(timings.cpuMs[pass]);
+			json << "        \"" << frameStageNames[pass] << "\": ";
+			writeStats(json, values);
+			json << (pass + 1 < STAGE_COUNT ? ",\n" : "\n");
+		}
+		json << "      }";
+		if (!scenario.gpuMs.empty()) {
+			json << ",\n      \"gpu_passes\": {\n";
+			for (size_t zone = 0; zone < scenario.gpuMs.size(); zone++) {
+				json << "        \"" << scenario.gpuMs[zone].first << "\": ";
+				writeStats(json, scenario.gpuMs[zone].second);
+				json << (zone + 1 < scenario.gpuMs.size() ? ",\n" : "\n");
+			}
+			json << "      }";
+		}
+		if (!scenario.glCalls.empty()) {
+			json << ",\n      \"gl_calls\": {\n";
+			for (int kind = 0; kind < GL_CALL_KIND_COUNT; kind++) {
+				vector<float> values;
+				for (const GlCallStats& calls : scenario.glCalls)
+					values.push_back((float)calls.calls[kind]);
+				json << "        \"" << glCallKindNames[kind] << "\": ";
+				writeStats(json, values);
+				json << (kind + 1 < GL_CALL_KIND_COUNT ? ",\n" : "\n");
+			}
+			json << "      }";
+		}
+		json << "\n";
+		json << "    }" << (i + 1 < scenarios.size() ? ",\n" : "\n");
+	}
+	json << "  ]\n";
+	json << "}\n";
+	return true;
+}
+
+void Benchmark::printSummary() const {
+	printf("%-20s %8s %8s %8s\n", "scenario", "p50", "p95", "p99");
+	for (const BenchmarkScenario& scenario : scenarios)
+		printf("%-20s %8.3f %8.3f %8.3f\n", scenario.name.c_str(),
+			percentile(scenario.frameMs, 50), percentile(scenario.frameMs, 95), percentile(scenario.frameMs, 99));
+}
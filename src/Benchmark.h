@@ -0,0 +1,84 @@
+#pragma once
+#include<iostream>
+#include<vector>
+#include<string>
+
+#include <glm/glm.hpp>
+
+#include "RenderSettings.h"
+#include "PassTimings.h"
+#include "GlCallCounter.h"
+#include "GpuProfiler.h"
+
+using namespace std;
+
+class TrainView;
+
+//camera key of a scenario, positions in between are interpolated
+struct BenchmarkKey
+{
+	int frame;
+	glm::vec3 position;
+	float yaw;
+	float pitch;
+};
+
+//interactive water drop at uv on a frame
+struct BenchmarkDrop
+{
+	int frame;
+	glm::vec2 uv;
+};
+
+//one scripted run: fixed UI state, a camera path and drops, measured after the warm up
+struct BenchmarkScenario
+{
+	string name;
+	int warmupFrames = 30;
+	int frames = 240;
+	int waveType = 1;
+	int lightType = 1;
+	bool pixelation = false;
+	bool offset = false;
+	bool grayscale = false;
+	vector<BenchmarkKey> camera;
+	vector<BenchmarkDrop> drops;
+
+	//results, one entry per measured frame
+	vector<float> frameMs;
+	vector<PassTimings> passMs;
+	vector<GlCallStats> glCalls;	//only with WATERSURFACE_GL_TRACE
+	//GPU time of each profiler zone (water, sky, interactive, post...) in first seen order,
+	//the profiler's results lag a few frames, the warm up covers that
+	vector<pair<string, vector<float>>> gpuMs;
+};
+
+//Plays scenarios with a fixed timestep and reports frame time percentiles per scenario
+//and per pass (CPU stages and GPU profiler zones) as JSON. The script is line based:
+//	scenario <name>
+//	frames <n>  warmup <n>
+//	wave <1-3>  light <1-3>  post <pixelation> <offset> <grayscale>
+//	camera <frame> <x> <y> <z> <yaw> <pitch>
+//	drop <frame> <u> <v>
+//lines starting with # are comments.
+//with WATERSURFACE_GL_TRACE the GL calls per frame by kind are reported too
+//(they don't depend on the machine, so any change is a regression or a fix)
+class Benchmark
+{
+public:
+	//camera orbit, every wave type, every light type, each post effect, water drops
+	void loadDefault();
+	bool load(const string& path);
+
+	//put the view in the state of frame (counting the warm up) of scenario
+	void apply(const BenchmarkScenario& scenario, int frame, TrainView& view, RenderSettings& settings) const;
+	void record(BenchmarkScenario& scenario, float frameMs, const PassTimings& passes, const vector<GpuZoneResult>& gpuZones) const;
+
+	bool writeJson(const string& path, const string& renderer, int width, int height, float deltaTime) const;
+	void printSummary() const;
+
+	vector<BenchmarkScenario> scenarios;
+};
+
+//p in [0, 100], nearest rank
+float percentile(vector<float> values, float p);
@@ -26,6 +26,7 @@
 #include "TrainWindow.H"
 #include "TrainView.H"
 #include "CallBacks.H"
+#include "CpuProfiler.h"
 
 #pragma warning(push)
 #pragma warning(disable:4312)
@@ -41,9 +42,12 @@
 void resetCB(Fl_Widget*, TrainWindow* tw)
 //===========================================================================
 {
-	tw->m_Track.resetPoints();
-	tw->trainView->selectedCube = -1;
-	tw->m_Track.trainU = 0;
+	//the track and the selection are the render thread's, edited there
+	tw->trainView->runOnRenderThread([tw]() {
+		tw->m_Track.resetPoints();
+		tw->trainView->selectedCube = -1;
+		tw->m_Track.trainU = 0;
+	});
 	tw->damageMe();
 }
 
@@ -64,23 +68,25 @@ void damageCB(Fl_Widget*, TrainWindow* tw)
 void addPointCB(Fl_Widget*, TrainWindow* tw)
 //===========================================================================
 {
-	// get the number of points
-	size_t npts = tw->m_Track.points.size();
-	// the number for the new point
-	size_t newidx = (tw->trainView->selectedCube>=0) ? tw->trainView->selectedCube : 0;
-
-	// pick a reasonable location
-	size_t previdx = (newidx + npts -1) % npts;
-	Pnt3f npos = (tw->m_Track.points[previdx].pos + tw->m_Track.points[newidx].pos) * .5f;
-
-	tw->m_Track.points.insert(tw->m_Track.points.begin() + newidx,npos);
-
-	// make it so that the train doesn't move - unless its affected by this control point
-	// it should stay between the same points
-	if (ceil(tw->m_Track.trainU) > ((float)newidx)) {
-		tw->m_Track.trainU += 1;
-		if (tw->m_Track.trainU >= npts) tw->m_Track.trainU -= npts;
-	}
+	tw->trainView->runOnRenderThread([tw]() {
+		// get the number of points
+		size_t npts = tw->m_Track.points.size();
+		// the number for the new point
+		size_t newidx = (tw->trainView->selectedCube>=0) ? tw->trainView->selectedCube : 0;
+
+		// pick a reasonable location
+		size_t previdx = (newidx + npts -1) % npts;
+		Pnt3f npos = (tw->m_Track.points[previdx].pos + tw->m_Track.points[newidx].pos) * .5f;
+
+		tw->m_Track.points.insert(tw->m_Track.points.begin() + newidx,npos);
+
+		// make it so that the train doesn't move - unless its affected by this control point
+		// it should stay between the same points
+		if (ceil(tw->m_Track.trainU) > ((float)newidx)) {
+			tw->m_Track.trainU += 1;
+			if (tw->m_Track.trainU >= npts) tw->m_Track.trainU -= npts;
+		}
+	});
 
 	tw->damageMe();
 }
@@ -92,12 +98,14 @@ void addPointCB(Fl_Widget*, TrainWindow* tw)
 void deletePointCB(Fl_Widget*, TrainWindow* tw)
 //===========================================================================
 {
-	if (tw->m_Track.points.size() > 4) {
-		if (tw->trainView->selectedCube >= 0) {
-			tw->m_Track.points.erase(tw->m_Track.points.begin() + tw->trainView->selectedCube);
-		} else
-			tw->m_Track.points.pop_back();
-	}
+	tw->trainView->runOnRenderThread([tw]() {
+		if (tw->m_Track.points.size() > 4) {
+			if (tw->trainView->selectedCube >= 0) {
+				tw->m_Track.points.erase(tw->m_Track.points.begin() + tw->trainView->selectedCube);
+			} else
+				tw->m_Track.points.pop_back();
+		}
+	});
 	tw->damageMe();
 }
 //***************************************************************************
@@ -134,6 +142,7 @@ static unsigned long lastRedraw = 0;
 void runButtonCB(TrainWindow* tw)
 //===========================================================================
 {
+	PROFILE_FUNCTION();
 	if (tw->runButton->value()) {	// only advance time if appropriate
 		if (clock() - lastRedraw > CLOCKS_PER_SEC/60) {
 			lastRedraw = clock();
@@ -153,7 +162,8 @@ void loadCB(Fl_Widget*, TrainWindow* tw)
 	const char* fname = 
 		fl_file_chooser("Pick a Track File","*.txt","TrackFiles/track.txt");
 	if (fname) {
-		tw->m_Track.readPoints(fname);
+		string path = fname;
+		tw->trainView->runOnRenderThread([tw, path]() { tw->m_Track.readPoints(path.c_str()); });
 		tw->damageMe();
 	}
 }
@@ -166,8 +176,10 @@ void saveCB(Fl_Widget*, TrainWindow* tw)
 {
 	const char* fname = 
 		fl_input("File name for save (should be *.txt)","TrackFiles/");
-	if (fname)
-		tw->m_Track.writePoints(fname);
+	if (fname) {
+		string path = fname;
+		tw->trainView->runOnRenderThread([tw, path]() { tw->m_Track.writePoints(path.c_str()); });
+	}
 }
 
 //***************************************************************************
@@ -176,14 +188,16 @@ void saveCB(Fl_Widget*, TrainWindow* tw)
 //===========================================================================
 void rollx(TrainWindow* tw, float dir)
 {
-	int s = tw->trainView->selectedCube;
-	if (s >= 0) {
-		Pnt3f old = tw->m_Track.points[s].orient;
-		float si = sin(((float)M_PI_4) * dir);
-		float co = cos(((float)M_PI_4) * dir);
-		tw->m_Track.points[s].orient.y = co * old.y - si * old.z;
-		tw->m_Track.points[s].orient.z = si * old.y + co * old.z;
-	}
+	tw->trainView->runOnRenderThread([tw, dir]() {
+		int s = tw->trainView->selectedCube;
+		if (s >= 0) {
+			Pnt3f old = tw->m_Track.points[s].orient;
+			float si = sin(((float)M_PI_4) * dir);
+			float co = cos(((float)M_PI_4) * dir);
+			tw->m_Track.points[s].orient.y = co * old.y - si * old.z;
+			tw->m_Track.points[s].orient.z = si * old.y + co * old.z;
+		}
+	});
 	tw->damageMe();
 } 
 
@@ -213,17 +227,19 @@ void rmxCB(Fl_Widget*, TrainWindow* tw)
 void rollz(TrainWindow* tw, float dir)
 //===========================================================================
 {
-	int s = tw->trainView->selectedCube;
-	if (s >= 0) {
+	tw->trainView->runOnRenderThread([tw, dir]() {
+		int s = tw->trainView->selectedCube;
+		if (s >= 0) {
 
-		Pnt3f old = tw->m_Track.points[s].orient;
+			Pnt3f old = tw->m_Track.points[s].orient;
 
-		float si = sin(((float)M_PI_4) * dir);
-		float co = cos(((float)M_PI_4) * dir);
+			float si = sin(((float)M_PI_4) * dir);
+			float co = cos(((float)M_PI_4) * dir);
 
-		tw->m_Track.points[s].orient.y = co * old.y - si * old.x;
-		tw->m_Track.points[s].orient.x = si * old.y + co * old.x;
-	}
+			tw->m_Track.points[s].orient.y = co * old.y - si * old.x;
+			tw->m_Track.points[s].orient.x = si * old.y + co * old.x;
+		}
+	});
 
 	tw->damageMe();
 }
@@ -0,0 +1,58 @@
+#include "CameraState.h"
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "Utilities/3DUtils.H"
+
+void CameraState::setPerspective(Camera& camera, float aspect, float nearPlane, float farPlane) {
+	view = camera.GetViewMatrix();
+	projection = glm::perspective(glm::radians(camera.Zoom), aspect, nearPlane, farPlane);
+	update();
+}
+
+void CameraState::setTopOrtho(float halfWidth, float halfHeight, float nearPlane, float farPlane) {
+	//same as glOrtho + glRotatef(-90,1,0,0)
+	view = glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1, 0, 0));
+	projection = glm::ortho(-halfWidth, halfWidth, -halfHeight, halfHeight, nearPlane, farPlane);
+	update();
+}
+
+void CameraState::setArcBall(const ArcBallCam& arcball, float aspect) {
+	HMatrix v, p;
+	arcball.getViewMatrix(v);
+	arcball.getProjectionMatrix(p, aspect);
+	view = glm::make_mat4((float*)v);
+	projection = glm::make_mat4((float*)p);
+	update();
+}
+
+void CameraState::setViewport(int x, int y, int width, int height) {
+	viewport[0] = x;
+	viewport[1] = y;
+	viewport[2] = width;
+	viewport[3] = height;
+}
+
+void CameraState::loadFixedFunction() const {
+	glMatrixMode(GL_PROJECTION);
+	glLoadMatrixf(&projection[0][0]);
+	glMatrixMode(GL_MODELVIEW);
+	glLoadMatrixf(&view[0][0]);
+}
+
+int CameraState::getMouseLine(int mx, int my, double& x1, double& y1, double& z1, double& x2, double& y2, double& z2) const {
+	double modelview[16], proj[16];
+	for (int i = 0; i < 16; i++) {
+		modelview[i] = view[i / 4][i % 4];
+		proj[i] = projection[i / 4][i % 4];
+	}
+	return ::getMouseLine(mx, my, modelview, proj, viewport, x1, y1, z1, x2, y2, z2);
+}
+
+void CameraState::update() {
+	viewProjection = projection * view;
+	glm::mat4 world = glm::inverse(view);
+	position = glm::vec3(world[3]);
+	front = -glm::vec3(world[2]);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <learnopengl/camera.h>
+
+#include "Utilities/ArcBallCam.H"
+
+using namespace std;
+
+//CPU copy of the camera for the current frame.
+//setProjection() fills it once per frame, everything else (UBO, shaders, water,
+//skybox, mouse picking) reads from here instead of querying the GL matrix stack.
+class CameraState
+{
+public:
+	//learnopengl fly camera (world view)
+	void setPerspective(Camera& camera, float aspect, float nearPlane, float farPlane);
+	//orthographic camera looking straight down (top view)
+	void setTopOrtho(float halfWidth, float halfHeight, float nearPlane, float farPlane);
+	//the FlTk arcball
+	void setArcBall(const ArcBallCam& arcball, float aspect);
+
+	void setViewport(int x, int y, int width, int height);
+
+	//load the matrices into the fixed function stack for the legacy drawing code (write only)
+	void loadFixedFunction() const;
+
+	//two points on the ray under the window pixel (mx, my), FlTk coordinates
+	int getMouseLine(int mx, int my, double& x1, double& y1, double& z1, double& x2, double& y2, double& z2) const;
+
+	glm::mat4 view = glm::mat4(1.0f);
+	glm::mat4 projection = glm::mat4(1.0f);
+	glm::mat4 viewProjection = glm::mat4(1.0f);
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::vec3 front = glm::vec3(0.0f, 0.0f, -1.0f);
+	int viewport[4] = { 0, 0, 1, 1 };
+
+private:
+	void update();
+};
@@ -0,0 +1,92 @@
+#include "CpuProfiler.h"
+
+#ifdef WATERSURFACE_CPU_PROFILER
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+
+//every thread that ever recorded, kept after the thread exits so its zones still get written
+static mutex buffersMutex;
+static vector<CpuThreadBuffer*> buffers;
+
+CpuThreadBuffer& CpuProfiler::threadBuffer() {
+	static thread_local CpuThreadBuffer* buffer = nullptr;
+	if (!buffer) {
+		buffer = new CpuThreadBuffer();
+		lock_guard<mutex> lock(buffersMutex);
+		buffer->threadId = (int)buffers.size() + 1;
+		buffer->name = buffer->threadId == 1 ? "main" : "thread " + to_string(buffer->threadId);
+		buffers.push_back(buffer);
+	}
+	return *buffer;
+}
+
+void CpuProfiler::setThreadName(const char* name) {
+	CpuThreadBuffer& buffer = threadBuffer();
+	lock_guard<mutex> lock(buffersMutex);
+	buffer.name = name;
+}
+
+//names are literals or __FUNCTION__, only quotes and backslashes need escaping
+static void writeJsonString(ofstream& file, const char* text) {
+	file << '"';
+	for (const char* c = text; *c; c++) {
+		if (*c == '"' || *c == '\\')
+			file << '\\';
+		file << *c;
+	}
+	file << '"';
+}
+
+bool CpuProfiler::writeChromeTrace(const string& path) {
+	ofstream file(path);
+	if (!file) {
+		cout << "CpuProfiler: can't write " << path << endl;
+		return false;
+	}
+
+	lock_guard<mutex> lock(buffersMutex);
+
+	//the oldest zone still in any ring is time zero
+	int64_t origin = INT64_MAX;
+	for (CpuThreadBuffer* buffer : buffers) {
+		uint64_t head = buffer->head.load(memory_order_acquire);
+		uint64_t first = head > CPU_PROFILER_EVENTS ? head - CPU_PROFILER_EVENTS : 0;
+		for (uint64_t i = first; i < head; i++)
+			origin = min(origin, buffer->events[i & (CPU_PROFILER_EVENTS - 1)].start);
+	}
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool firstEvent = true;
+	size_t count = 0;
+	for (CpuThreadBuffer* buffer : buffers) {
+		if (!firstEvent)
+			file << ",\n";
+		firstEvent = false;
+		file << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << buffer->threadId << ",\"args\":{\"name\":";
+		writeJsonString(file, buffer->name.c_str());
+		file << "}}";
+
+		//the owner may still be writing; skip the slots it could be overwriting right now
+		uint64_t head = buffer->head.load(memory_order_acquire);
+		uint64_t first = head > CPU_PROFILER_EVENTS ? head - CPU_PROFILER_EVENTS + 64 : 0;
+		for (uint64_t i = first; i < head; i++) {
+			const CpuZoneEvent& event = buffer->events[i & (CPU_PROFILER_EVENTS - 1)];
+			file << ",\n{\"ph\":\"X\",\"name\":";
+			writeJsonString(file, event.name);
+			file << ",\"pid\":1,\"tid\":" << buffer->threadId
+				<< ",\"ts\":" << (event.start - origin) / 1000.0
+				<< ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+			count++;
+		}
+	}
+	file << "\n]}\n";
+
+	cout << "CpuProfiler: " << count << " zones of " << buffers.size() << " threads written to " << path << endl;
+	return true;
+}
+
+#endif
@@ -0,0 +1,86 @@
+#pragma once
+//CPU zone profiler, compiled in with the WATERSURFACE_CPU_PROFILER CMake option.
+//	PROFILE_ZONE("name")		times the enclosing block
+//	PROFILE_FUNCTION()			same, named after the function
+//	PROFILE_THREAD("name")		names the calling thread in the trace
+//	PROFILE_WRITE("file.json")	writes every thread's zones as a Chrome trace (chrome://tracing, Perfetto)
+//without the option all of them expand to nothing.
+
+#ifdef WATERSURFACE_CPU_PROFILER
+
+#include<atomic>
+#include<chrono>
+#include<string>
+#include<cstdint>
+
+using namespace std;
+
+//zones kept per thread, older ones are overwritten
+#define CPU_PROFILER_EVENTS (1 << 16)
+
+struct CpuZoneEvent
+{
+	const char* name;
+	int64_t start;		//steady_clock nanoseconds
+	int64_t end;
+};
+
+//written by its thread only; head is published with release so a flush sees whole events
+struct CpuThreadBuffer
+{
+	CpuZoneEvent events[CPU_PROFILER_EVENTS];
+	atomic<uint64_t> head{ 0 };		//events ever written
+	int threadId = 0;
+	string name;
+};
+
+class CpuProfiler
+{
+public:
+	static int64_t now() {
+		return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	//no locks and no allocation after the first zone of a thread
+	static void record(const char* name, int64_t start, int64_t end) {
+		CpuThreadBuffer& buffer = threadBuffer();
+		uint64_t head = buffer.head.load(memory_order_relaxed);
+		CpuZoneEvent& event = buffer.events[head & (CPU_PROFILER_EVENTS - 1)];
+		event.name = name;
+		event.start = start;
+		event.end = end;
+		buffer.head.store(head + 1, memory_order_release);
+	}
+
+	static void setThreadName(const char* name);
+	static bool writeChromeTrace(const string& path);
+
+private:
+	//the calling thread's buffer, registered on first use
+	static CpuThreadBuffer& threadBuffer();
+};
+
+struct CpuZone
+{
+	CpuZone(const char* name) : name(name), start(CpuProfiler::now()) {}
+	~CpuZone() { CpuProfiler::record(name, start, CpuProfiler::now()); }
+
+	const char* name;
+	int64_t start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) CpuZone PROFILE_CONCAT(cpuZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__FUNCTION__)
+#define PROFILE_THREAD(name) CpuProfiler::setThreadName(name)
+#define PROFILE_WRITE(path) CpuProfiler::writeChromeTrace(path)
+
+#else
+
+#define PROFILE_ZONE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_THREAD(name)
+#define PROFILE_WRITE(path) (false)
+
+#endif
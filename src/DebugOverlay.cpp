@@ -0,0 +1,163 @@
+#include "DebugOverlay.h"
+#include <cstdio>
+#include <algorithm>
+
+#include <FL/Fl.H>
+#include <FL/gl.h>
+
+#include "GpuMemory.h"
+#include "GlCallCounter.h"
+
+void DebugOverlay::begin2D(int width, int height) {
+	glUseProgram(0);
+	glBindVertexArray(0);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_TEXTURE_2D);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(0, width, 0, height, -1, 1);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+}
+
+void DebugOverlay::end2D() {
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glPopMatrix();
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+}
+
+void DebugOverlay::draw(const GpuProfiler& profiler, int width, int height) {
+	if (!visible)
+		return;
+
+	const vector<GpuZoneHistory>& history = profiler.getHistory();
+	const int rowHeight = 16;
+	const int labelWidth = 150;
+	const float barWidth = 200.0f;
+	const float graphHeight = rowHeight - 4.0f;
+
+	begin2D(width, height);
+
+	//one more row for the GL call counts when they are counted
+	int footerRows = GlCallCounter::isInstalled() ? 2 : 1;
+	float top = (float)height - 8.0f;
+	float bottom = top - rowHeight * (history.size() + footerRows);
+	float right = 8.0f + labelWidth + barWidth + 8.0f + GPU_PROFILER_HISTORY;
+	glColor4f(0.0f, 0.0f, 0.0f, 0.6f);
+	glRecti(4, (int)bottom - 4, (int)right + 4, (int)top + 4);
+
+	//FLTK's font state is shared with the UI thread when this runs on the render thread
+	Fl::lock();
+	gl_font(FL_HELVETICA, 12);
+	char text[128];
+	float y = top - rowHeight;
+	for (const GpuZoneHistory& row : history) {
+		float x = 8.0f + row.depth * 8.0f;
+		glColor3f(1.0f, 1.0f, 1.0f);
+		snprintf(text, sizeof(text), "%s %.2f ms", row.name, row.average);
+		gl_draw(text, x, y + 3.0f);
+
+		//average, red past the budget
+		float bar = min(row.average / budgetMs, 1.0f) * barWidth;
+		float barLeft = 8.0f + labelWidth;
+		if (row.average > budgetMs)
+			glColor3f(0.9f, 0.2f, 0.2f);
+		else
+			glColor3f(0.2f, 0.8f, 0.3f);
+		glRectf(barLeft, y + 2.0f, barLeft + bar, y + rowHeight - 2.0f);
+
+		//history, one column per frame
+		float graphLeft = barLeft + barWidth + 8.0f;
+		glColor3f(0.9f, 0.8f, 0.2f);
+		glBegin(GL_LINES);
+		for (int i = 0; i < GPU_PROFILER_HISTORY; i++) {
+			//oldest on the left
+			float ms = row.ms[(profiler.getHistoryHead() + i) % GPU_PROFILER_HISTORY];
+			float h = min(ms / budgetMs, 1.0f) * graphHeight;
+			glVertex2f(graphLeft + i + 0.5f, y + 2.0f);
+			glVertex2f(graphLeft + i + 0.5f, y + 2.0f + h);
+		}
+		glEnd();
+
+		y -= rowHeight;
+	}
+
+	glColor3f(0.7f, 0.7f, 0.7f);
+	snprintf(text, sizeof(text), "GPU, %d frames skipped%s", profiler.getSkippedFrames(),
+		profiler.isWritingCsv() ? ", writing csv" : "");
+	gl_draw(text, 8.0f, y + 3.0f);
+
+	if (GlCallCounter::isInstalled()) {
+		const GlCallStats& calls = GlCallCounter::getLastFrame();
+		y -= rowHeight;
+		//sync calls in red, each one can stall the frame
+		if (calls.calls[GL_CALL_SYNC])
+			glColor3f(1.0f, 0.4f, 0.4f);
+		else
+			glColor3f(0.7f, 0.7f, 0.7f);
+		snprintf(text, sizeof(text), "GL %u calls: %u draw %u bind %u uniform %u upload %u state %u sync",
+			calls.total, calls.calls[GL_CALL_DRAW], calls.calls[GL_CALL_BIND], calls.calls[GL_CALL_UNIFORM],
+			calls.calls[GL_CALL_UPLOAD], calls.calls[GL_CALL_STATE], calls.calls[GL_CALL_SYNC]);
+		gl_draw(text, 8.0f, y + 3.0f);
+	}
+	Fl::unlock();
+
+	end2D();
+}
+
+void DebugOverlay::drawMemory(int width, int height) {
+	if (!memoryVisible)
+		return;
+
+	const int rowHeight = 16;
+	const float panelWidth = 330.0f;
+	const float barWidth = 100.0f;
+	const float mb = 1024.0f * 1024.0f;
+
+	begin2D(width, height);
+
+	float top = (float)height - 8.0f;
+	float bottom = top - rowHeight * (GPU_MEMORY_CATEGORY_COUNT + 1);
+	float left = width - panelWidth - 8.0f;
+	glColor4f(0.0f, 0.0f, 0.0f, 0.6f);
+	glRecti((int)left - 4, (int)bottom - 4, (int)(left + panelWidth) + 4, (int)top + 4);
+
+	//bars are shares of the total high-water mark
+	float scale = GpuMemory::getPeakBytes() ? barWidth / GpuMemory::getPeakBytes() : 0.0f;
+	Fl::lock();
+	gl_font(FL_HELVETICA, 12);
+	char text[96];
+	float y = top - rowHeight;
+	for (int i = 0; i < GPU_MEMORY_CATEGORY_COUNT; i++) {
+		const GpuMemoryStats& stats = GpuMemory::getStats((GpuMemoryCategory)i);
+		glColor3f(1.0f, 1.0f, 1.0f);
+		snprintf(text, sizeof(text), "%s %.1f MB (peak %.1f)", gpuMemoryCategoryNames[i],
+			stats.bytes / mb, stats.peakBytes / mb);
+		gl_draw(text, left, y + 3.0f);
+
+		float barLeft = left + panelWidth - barWidth;
+		glColor3f(0.3f, 0.3f, 0.3f);
+		glRectf(barLeft, y + 2.0f, barLeft + stats.peakBytes * scale, y + rowHeight - 2.0f);
+		glColor3f(0.2f, 0.6f, 0.9f);
+		glRectf(barLeft, y + 2.0f, barLeft + stats.bytes * scale, y + rowHeight - 2.0f);
+
+		y -= rowHeight;
+	}
+
+	glColor3f(0.7f, 0.7f, 0.7f);
+	snprintf(text, sizeof(text), "GPU memory %.1f MB, peak %.1f MB (estimated)",
+		GpuMemory::getTotalBytes() / mb, GpuMemory::getPeakBytes() / mb);
+	gl_draw(text, left, y + 3.0f);
+	Fl::unlock();
+
+	end2D();
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "GpuProfiler.h"
+
+//on screen GPU timings: one row per profiler zone with its name, the rolling average
+//as a bar and the last GPU_PROFILER_HISTORY frames as a graph.
+//with WATERSURFACE_GL_TRACE the GL calls of the last frame by kind go under the timings.
+//GPU memory: one row per GpuMemory category with its size and high-water mark, top right.
+//drawn with the fixed function pipeline on top of the window, after the frame
+class DebugOverlay
+{
+public:
+	void draw(const GpuProfiler& profiler, int width, int height);
+	void drawMemory(int width, int height);
+
+	bool visible = false;
+	bool memoryVisible = false;
+	//bar length of budgetMs (the frame budget)
+	float budgetMs = 16.6f;
+
+private:
+	//window pixel projection, y up
+	void begin2D(int width, int height);
+	void end2D();
+};
@@ -0,0 +1,103 @@
+#include "DynamicResolution.h"
+#include <cmath>
+
+//weight of the newest sample in the smoothed frame time
+static const float SMOOTHING = 0.1f;
+//frames the time has to stay over / under budget before the scale moves
+//(going up is slower, a wrong guess there costs a dropped frame)
+static const int DOWN_FRAMES = 15;
+static const int UP_FRAMES = 60;
+//frames to wait after a change for the new resolution to show in the timings
+static const int COOLDOWN_FRAMES = 30;
+//scales are snapped to this step so small changes do not resize every frame
+static const float SCALE_STEP = 0.05f;
+
+DynamicResolution::DynamicResolution(float targetMs, float minScale, float maxScale)
+	: targetMs(targetMs), minScale(minScale), maxScale(maxScale) {
+	scale = maxScale;
+	for (int i = 0; i < RESOLUTION_QUERY_COUNT; i++)
+		issued[i] = false;
+
+	gpuTimer = GLAD_GL_VERSION_3_3 != 0;
+	if (gpuTimer)
+		glGenQueries(RESOLUTION_QUERY_COUNT, queries);
+	else
+		cout << "DYNAMIC_RESOLUTION::NO_TIMER_QUERY using CPU frame time" << endl;
+}
+
+DynamicResolution::~DynamicResolution() {
+	if (gpuTimer)
+		glDeleteQueries(RESOLUTION_QUERY_COUNT, queries);
+}
+
+void DynamicResolution::beginFrame() {
+	if (gpuTimer)
+		glBeginQuery(GL_TIME_ELAPSED, queries[frame]);
+}
+
+void DynamicResolution::endFrame(float cpuFrameMs) {
+	if (!gpuTimer) {
+		update(cpuFrameMs);
+		return;
+	}
+
+	glEndQuery(GL_TIME_ELAPSED);
+	issued[frame] = true;
+	frame = (frame + 1) % RESOLUTION_QUERY_COUNT;
+
+	//the next slot holds the oldest query; only read it once it is done
+	if (issued[frame]) {
+		GLint available = 0;
+		glGetQueryObjectiv(queries[frame], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available) {
+			GLuint64 ns = 0;
+			glGetQueryObjectui64v(queries[frame], GL_QUERY_RESULT, &ns);
+			issued[frame] = false;
+			update(ns / 1000000.0f);
+		}
+	}
+}
+
+void DynamicResolution::update(float frameMs) {
+	smoothedMs = smoothedMs <= 0 ? frameMs : smoothedMs + (frameMs - smoothedMs) * SMOOTHING;
+	if (!enabled)
+		return;
+
+	if (cooldown > 0) {
+		cooldown--;
+		return;
+	}
+
+	if (smoothedMs > targetMs * (1.0f + band)) {
+		overBudget++;
+		underBudget = 0;
+	}
+	else if (smoothedMs < targetMs * (1.0f - band)) {
+		underBudget++;
+		overBudget = 0;
+	}
+	else {
+		overBudget = 0;
+		underBudget = 0;
+	}
+
+	if (overBudget < DOWN_FRAMES && underBudget < UP_FRAMES)
+		return;
+
+	//cost follows the pixel count, so the scale that hits the target is sqrt of the ratio;
+	//only go half way there
+	float ideal = scale * sqrtf(targetMs / smoothedMs);
+	float next = scale + (ideal - scale) * 0.5f;
+	next = floorf(next / SCALE_STEP + 0.5f) * SCALE_STEP;
+	if (next < minScale)
+		next = minScale;
+	if (next > maxScale)
+		next = maxScale;
+
+	overBudget = 0;
+	underBudget = 0;
+	if (next != scale) {
+		scale = next;
+		cooldown = COOLDOWN_FRAMES;
+	}
+}
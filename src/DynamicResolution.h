@@ -0,0 +1,54 @@
+#pragma once
+#include<iostream>
+
+#include <glad/glad.h>
+
+using namespace std;
+
+//number of GPU timer queries in flight, results are read a few frames late so we never stall
+#define RESOLUTION_QUERY_COUNT 3
+
+//Scales the resolution of the main scene target to hold a target frame time.
+//The frame time comes from GL_TIME_ELAPSED queries, or from the CPU frame time
+//when timer queries are not available.
+//Scale changes are damped: the smoothed time has to stay outside a band around
+//the target for a number of frames, and after a change the controller waits
+//before it looks again, so the resolution does not oscillate.
+class DynamicResolution
+{
+public:
+	DynamicResolution(float targetMs = 16.6f, float minScale = 0.5f, float maxScale = 1.0f);
+	~DynamicResolution();
+
+	//bracket everything the GPU does in a frame
+	void beginFrame();
+	void endFrame(float cpuFrameMs);
+
+	//render size for a target of baseWidth x baseHeight
+	int getWidth(int baseWidth) const	{ return (int)(baseWidth * getScale() + 0.5f); }
+	int getHeight(int baseHeight) const	{ return (int)(baseHeight * getScale() + 0.5f); }
+	float getScale() const				{ return enabled ? scale : 1.0f; }
+	float getFrameMs() const			{ return smoothedMs; }
+	bool usesGpuTimer() const			{ return gpuTimer; }
+
+	bool enabled = true;
+	float targetMs;
+	float minScale;
+	float maxScale;
+	//fraction of the target the frame time may drift before the scale changes
+	float band = 0.1f;
+
+private:
+	void update(float frameMs);
+
+	float scale = 1.0f;
+	float smoothedMs = 0;
+	int overBudget = 0;
+	int underBudget = 0;
+	int cooldown = 0;
+
+	bool gpuTimer = false;
+	GLuint queries[RESOLUTION_QUERY_COUNT];
+	bool issued[RESOLUTION_QUERY_COUNT];
+	int frame = 0;
+};
@@ -21,6 +21,61 @@
 #include <sstream>
 //#include "glExtension.h"
 #include "FrameBuffer.h"
+#include "GpuMemory.h"
+
+size_t FrameBuffer::totalCpuBytes = 0;
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// number of levels in the color texture
+///////////////////////////////////////////////////////////////////////////////
+int FrameBufferDesc::getMipLevels() const
+{
+    if(!mipmaps)
+        return 1;
+
+    int levels = 1;
+    int size = (width > height) ? width : height;
+    while(size > 1)
+    {
+        size >>= 1;
+        ++levels;
+    }
+    return levels;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// estimate the GPU memory of the targets described
+///////////////////////////////////////////////////////////////////////////////
+size_t FrameBufferDesc::getMemorySize() const
+{
+    // the same per-format sizes as every other tracked texture
+    size_t bytes = GpuMemory::textureSize(colorFormat, width, height, 1, mipmaps);
+    if(depth)
+        bytes += GpuMemory::textureSize(GL_DEPTH_COMPONENT24, width, height);
+    // the multi-sample renderbuffers, one "layer" per sample
+    if(msaa > 0)
+    {
+        bytes += GpuMemory::textureSize(colorFormat, width, height, msaa);
+        if(depth)
+            bytes += GpuMemory::textureSize(GL_DEPTH_COMPONENT24, width, height, msaa);
+    }
+    return bytes;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// estimate of what was allocated, with the validated msaa count
+///////////////////////////////////////////////////////////////////////////////
+size_t FrameBuffer::getMemorySize() const
+{
+    FrameBufferDesc allocated = desc;
+    allocated.msaa = msaa;
+    return allocated.getMemorySize();
+}
 
 
 
@@ -51,6 +106,15 @@ FrameBuffer::~FrameBuffer()
 ///////////////////////////////////////////////////////////////////////////////
 bool FrameBuffer::init(int width, int height, int msaa)
 {
+    return init(FrameBufferDesc(width, height, GL_RGBA8, true, true, msaa));
+}
+
+bool FrameBuffer::init(const FrameBufferDesc& desc)
+{
+    int width = desc.width;
+    int height = desc.height;
+    int msaa = desc.msaa;
+
     // check w/h
     if(width <= 0 || height <= 0)
     {
@@ -71,16 +135,13 @@ bool FrameBuffer::init(int width, int height, int msaa)
     // reset error message
     errorMessage = "no error";
 
+    // reset buffers, while width/height still describe the CPU copies being freed
+    deleteBuffers();
+
     this->width = width;
     this->height = height;
     this->msaa = msaa;
-
-    // reset buffers
-    deleteBuffers();
-
-    // create arrays
-    colorBuffer = new unsigned char[width * height * 4];    // 32 bits per pixel
-    depthBuffer = new float[width * height];                // 32 bits per pixel
+    this->desc = desc;
 
     // create single-sample FBO
     glGenFramebuffers(1, &fboId);
@@ -90,18 +151,21 @@ bool FrameBuffer::init(int width, int height, int msaa)
     glGenTextures(1, &texId);
     glBindTexture(GL_TEXTURE_2D, texId);
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, desc.mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE); // automatic mipmap generation included in OpenGL v1.4
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    // immutable storage with exactly the levels asked for, no mip chain unless wanted
+    glTexStorage2D(GL_TEXTURE_2D, desc.getMipLevels(), desc.colorFormat, width, height);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texId, 0);
 
     // create a renderbuffer object to store depth info, attach it to fbo
-    glGenRenderbuffers(1, &rboId);
-    glBindRenderbuffer(GL_RENDERBUFFER, rboId);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboId);
+    if(desc.depth)
+    {
+        glGenRenderbuffers(1, &rboId);
+        glBindRenderbuffer(GL_RENDERBUFFER, rboId);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboId);
+    }
 
     // check FBO completeness
     bool status = checkFrameBufferStatus();
@@ -115,23 +179,30 @@ bool FrameBuffer::init(int width, int height, int msaa)
         // create a render buffer object to store colour info
         glGenRenderbuffers(1, &rboMsaaColorId);
         glBindRenderbuffer(GL_RENDERBUFFER, rboMsaaColorId);
-        glRenderbufferStorageMultisample(GL_RENDERBUFFER, msaa, GL_RGB8, width, height);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, msaa, desc.colorFormat, width, height);
 
         // attach a renderbuffer to FBO color attachment point
         glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rboMsaaColorId);
 
         // create a renderbuffer object to store depth info
-        glGenRenderbuffers(1, &rboMsaaDepthId);
-        glBindRenderbuffer(GL_RENDERBUFFER, rboMsaaDepthId);
-        glRenderbufferStorageMultisample(GL_RENDERBUFFER, msaa, GL_DEPTH_COMPONENT, width, height);
+        if(desc.depth)
+        {
+            glGenRenderbuffers(1, &rboMsaaDepthId);
+            glBindRenderbuffer(GL_RENDERBUFFER, rboMsaaDepthId);
+            glRenderbufferStorageMultisample(GL_RENDERBUFFER, msaa, GL_DEPTH_COMPONENT24, width, height);
 
-        // attach a renderbuffer to FBO depth attachment point
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboMsaaDepthId);
+            // attach a renderbuffer to FBO depth attachment point
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboMsaaDepthId);
+        }
 
         // check FBO completeness again
         status = checkFrameBufferStatus();
     }
 
+    // one entry for the colour, depth and MSAA buffers of this target
+    GpuMemory::track(GL_FRAMEBUFFER, fboId, GPU_MEMORY_FRAMEBUFFER, getMemorySize(),
+                     "framebuffer " + std::to_string(width) + "x" + std::to_string(height));
+
     // unbound
     glBindRenderbuffer(GL_RENDERBUFFER, 0);
     glBindTexture(GL_TEXTURE_2D, 0);
@@ -173,16 +244,44 @@ void FrameBuffer::deleteBuffers()
     }
     if(fboId)
     {
+        GpuMemory::untrack(GL_FRAMEBUFFER, fboId);
         glDeleteFramebuffers(1, &fboId);
         fboId = 0;
     }
 
+    releaseCpuBuffers();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// free the CPU copies of color/depth buffers
+///////////////////////////////////////////////////////////////////////////////
+void FrameBuffer::releaseCpuBuffers()
+{
+    totalCpuBytes -= getCpuMemorySize();
     delete [] colorBuffer;  colorBuffer = 0;
     delete [] depthBuffer;  depthBuffer = 0;
 }
 
 
 
+///////////////////////////////////////////////////////////////////////////////
+// bytes held by the CPU copies
+///////////////////////////////////////////////////////////////////////////////
+size_t FrameBuffer::getCpuMemorySize() const
+{
+    size_t pixels = (size_t)width * height;
+    size_t bytes = 0;
+    if(colorBuffer)
+        bytes += pixels * 4;    // 32 bits per pixel
+    if(depthBuffer)
+        bytes += pixels * sizeof(float);
+    return bytes;
+}
+
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // return FBO ID
 ///////////////////////////////////////////////////////////////////////////////
@@ -238,10 +337,13 @@ void FrameBuffer::update()
         */
     }
 
-    // also, generate mipmaps for color buffer (texture)
-    glBindTexture(GL_TEXTURE_2D, texId);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    // also, generate mipmaps for color buffer (texture), only if it has them
+    if(desc.mipmaps)
+    {
+        glBindTexture(GL_TEXTURE_2D, texId);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
 }
 
 
@@ -287,6 +389,12 @@ void FrameBuffer::blitDepthTo(GLuint dstId, int x, int y, int width, int height)
 ///////////////////////////////////////////////////////////////////////////////
 void FrameBuffer::copyColorBuffer()
 {
+    if(!colorBuffer)
+    {
+        colorBuffer = new unsigned char[width * height * 4];    // 32 bits per pixel
+        totalCpuBytes += (size_t)width * height * 4;
+    }
+
     blitColorTo(fboId); // copy multi-sample to single-sample first
     glBindFramebuffer(GL_READ_FRAMEBUFFER, fboId);
     glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, colorBuffer);
@@ -299,6 +407,17 @@ void FrameBuffer::copyColorBuffer()
 ///////////////////////////////////////////////////////////////////////////////
 void FrameBuffer::copyDepthBuffer()
 {
+    if(!desc.depth)
+    {
+        errorMessage = "[ERROR] FrameBuffer::copyDepthBuffer(): FBO has no depth buffer.";
+        return;
+    }
+    if(!depthBuffer)
+    {
+        depthBuffer = new float[width * height];                // 32 bits per pixel
+        totalCpuBytes += (size_t)width * height * sizeof(float);
+    }
+
     blitDepthTo(fboId);  // copy multi-sample to single-sample first
     glBindFramebuffer(GL_READ_FRAMEBUFFER, fboId);
     glReadPixels(0, 0, width, height, GL_DEPTH_COMPONENT, GL_FLOAT, depthBuffer);
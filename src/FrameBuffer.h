@@ -2,8 +2,15 @@
 // FrameBuffer.h
 // =============
 // class for OpenGL Frame Buffer Object (FBO)
-// It contains a 32bit color buffer and a depth buffer as GL_DEPTH_COMPONENT24
-// Call init() to create/resize a FBO with given width and height params.
+// It contains a color buffer of the format given by FrameBufferDesc and an
+// optional depth buffer as GL_DEPTH_COMPONENT24.
+// Call init() to create/resize a FBO with a FrameBufferDesc, or with given
+// width and height params (RGBA8 + depth + mipmaps).
+// The color mip chain only exists (and is only regenerated in update()) if
+// the descriptor asks for it.
+// The CPU side copies (getColorBuffer()/getDepthBuffer()) are allocated on the
+// first copyColorBuffer()/copyDepthBuffer() call, and can be freed again with
+// releaseCpuBuffers(). They are null until then.
 // It supports MSAA (Multi Sample Anti Aliasing) FBO. If msaa=0, it creates a
 // single-sampled FBO. If msaa > 0 (even number), it creates a multi-sampled
 // FBO.
@@ -31,32 +38,67 @@
 
 #include <string>
 
+///////////////////////////////////////////////////////////////////////////////
+// what a FrameBuffer allocates
+///////////////////////////////////////////////////////////////////////////////
+struct FrameBufferDesc
+{
+    int width;
+    int height;
+    GLenum colorFormat;     // sized internal format; GL_RGBA8, GL_RGBA16F, GL_RG16F, GL_R16F,...
+    bool mipmaps;           // allocate a mip chain and regenerate it in update()
+    bool depth;             // attach a depth buffer
+    int msaa;               // # of multi samples; 0, 2, 4, 8,...
+
+    FrameBufferDesc(int width=0, int height=0, GLenum colorFormat=GL_RGBA8,
+                    bool mipmaps=false, bool depth=true, int msaa=0)
+        : width(width), height(height), colorFormat(colorFormat),
+          mipmaps(mipmaps), depth(depth), msaa(msaa) {}
+
+    bool operator==(const FrameBufferDesc& rhs) const
+    {
+        return width == rhs.width && height == rhs.height && colorFormat == rhs.colorFormat &&
+               mipmaps == rhs.mipmaps && depth == rhs.depth && msaa == rhs.msaa;
+    }
+
+    int getMipLevels() const;                       // 1 if no mipmaps
+    size_t getMemorySize() const;                   // GPU bytes, estimated from the formats
+};
+
 class FrameBuffer
 {
 public:
     FrameBuffer();
     ~FrameBuffer();
 
-    bool init(int width, int height, int msaa=0);   // create buffer objects
+    bool init(const FrameBufferDesc& desc);         // create buffer objects
+    bool init(int width, int height, int msaa=0);   // RGBA8 color with mipmaps and depth
     void bind();                                    // bind fbo
     void unbind();                                  // unbind fbo
-    void update();                                  // copy multi-sample to single-sample and generate mipmaps
+    void update();                                  // copy multi-sample to single-sample and generate mipmaps (if any)
 
     void blitColorTo(GLuint fbo, int x=0, int y=0, int w=0, int h=0);   // copy color buffer only
     void blitDepthTo(GLuint fbo, int x=0, int y=0, int w=0, int h=0);   // copy depth buffer only
 
-    void copyColorBuffer();                         // copy color to array
-    void copyDepthBuffer();                         // copy depth to array
+    void copyColorBuffer();                         // copy color to array (allocated on first call)
+    void copyDepthBuffer();                         // copy depth to array (allocated on first call)
     const unsigned char* getColorBuffer() const     { return colorBuffer; }
     const float* getDepthBuffer() const             { return depthBuffer; }
+    void releaseCpuBuffers();                       // free the arrays until the next copy
+
+    size_t getCpuMemorySize() const;                // bytes held by the arrays of this FBO
+    static size_t getTotalCpuMemorySize()           { return totalCpuBytes; }   // all FBOs
 
     GLuint getId() const;
+    GLuint getResolveId() const                     { return fboId; }   // single-sample FBO, for reading
     GLuint getColorId() const                       { return texId; }   // single-sample texture object
     GLuint getDepthId() const                       { return rboId; }   // single-sample rbo
 
     int getWidth() const                            { return width; }
     int getHeight() const                           { return height; }
     int getMsaa() const                             { return msaa; }
+    const FrameBufferDesc& getDesc() const          { return desc; }   // as requested, FrameBufferPool matches on it
+    size_t getMemorySize() const;                   // GPU bytes, with the msaa count really used
     std::string getStatus() const;                  // return FBO info
     std::string getErrorMessage() const             { return errorMessage; }
 
@@ -75,8 +117,10 @@ private:
     int width;                      // buffer width
     int height;                     // buffer height
     int msaa;                       // # of multi samples; 0, 2, 4, 8,...
-    unsigned char* colorBuffer;     // color buffer (rgba)
-    float* depthBuffer;             // depth buffer
+    FrameBufferDesc desc;           // what was asked for, the validated msaa count is in msaa
+    unsigned char* colorBuffer;     // color buffer (rgba), null until copyColorBuffer()
+    float* depthBuffer;             // depth buffer, null until copyDepthBuffer()
+    static size_t totalCpuBytes;    // sum of getCpuMemorySize() of all FBOs
     GLuint fboMsaaId;               // primary id for multisample FBO
     GLuint rboMsaaColorId;          // id for multisample RBO (color buffer)
     GLuint rboMsaaDepthId;          // id for multisample RBO (depth buffer)
@@ -0,0 +1,66 @@
+#include "FrameBufferPool.h"
+
+FrameBufferPool::~FrameBufferPool() {
+	for (Entry& entry : entries)
+		delete entry.fbo;
+}
+
+FrameBuffer* FrameBufferPool::acquire(const FrameBufferDesc& desc) {
+	for (Entry& entry : entries) {
+		if (!entry.inUse && entry.fbo->getDesc() == desc) {
+			entry.inUse = true;
+			return entry.fbo;
+		}
+	}
+
+	FrameBuffer* fbo = new FrameBuffer();
+	if (!fbo->init(desc)) {
+		cout << "FrameBufferPool: failed to create a " << desc.width << "x" << desc.height << " target" << endl;
+		delete fbo;
+		return nullptr;
+	}
+	entries.push_back({ fbo, true });
+	return fbo;
+}
+
+void FrameBufferPool::release(FrameBuffer* fbo) {
+	for (Entry& entry : entries) {
+		if (entry.fbo == fbo) {
+			entry.inUse = false;
+			return;
+		}
+	}
+	cout << "FrameBufferPool: released a target the pool does not own" << endl;
+}
+
+void FrameBufferPool::trim() {
+	for (size_t i = 0; i < entries.size();) {
+		if (!entries[i].inUse) {
+			delete entries[i].fbo;
+			entries.erase(entries.begin() + i);
+		}
+		else
+			i++;
+	}
+}
+
+int FrameBufferPool::getFreeCount() const {
+	int count = 0;
+	for (const Entry& entry : entries)
+		if (!entry.inUse)
+			count++;
+	return count;
+}
+
+size_t FrameBufferPool::getMemorySize() const {
+	size_t bytes = 0;
+	for (const Entry& entry : entries)
+		bytes += entry.fbo->getMemorySize();
+	return bytes;
+}
+
+void FrameBufferPool::printStats() const {
+	cout << "FrameBufferPool: " << getTotalCount() << " targets (" << getFreeCount() << " free), "
+		<< getMemorySize() / (1024 * 1024) << " MB GPU, "
+		<< FrameBuffer::getTotalCpuMemorySize() / (1024 * 1024) << " MB CPU copies" << endl;
+}
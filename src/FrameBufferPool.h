@@ -0,0 +1,36 @@
+#pragma once
+#include<iostream>
+#include<vector>
+
+#include "FrameBuffer.h"
+
+using namespace std;
+
+//owns every FrameBuffer of the view, keyed by FrameBufferDesc.
+//acquire() hands back a released target with the same descriptor before allocating a new one,
+//so render targets are created once instead of per pass.
+class FrameBufferPool
+{
+public:
+	~FrameBufferPool();
+
+	FrameBuffer* acquire(const FrameBufferDesc& desc);
+	//give a target back to the pool, it stays allocated for the next acquire
+	void release(FrameBuffer* fbo);
+	//delete the released targets
+	void trim();
+
+	int getTotalCount() const	{ return (int)entries.size(); }
+	int getFreeCount() const;
+	//estimated GPU bytes of all targets owned by the pool
+	size_t getMemorySize() const;
+	void printStats() const;
+
+private:
+	struct Entry
+	{
+		FrameBuffer* fbo;
+		bool inUse;
+	};
+	vector<Entry> entries;
+};
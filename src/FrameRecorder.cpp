@@ -0,0 +1,161 @@
+#include "FrameRecorder.h"
+#include "CpuProfiler.h"
+#include <algorithm>
+#include <cstdio>
+
+#include <opencv2/opencv.hpp>
+
+FrameRecorder::FrameRecorder(AsyncReadback& readback, int queueCapacity)
+	: readback(readback), queueCapacity(queueCapacity) {
+}
+
+FrameRecorder::~FrameRecorder() {
+	stop();
+}
+
+bool FrameRecorder::start(const string& path, RecordFormat format, int width, int height, int every, int fps) {
+	if (recording)
+		stop();
+
+	this->path = path;
+	this->format = format;
+	this->width = width & ~1;
+	this->height = height & ~1;
+	this->every = max(every, 1);
+	if (this->width <= 0 || this->height <= 0) {
+		cout << "FrameRecorder: nothing to record at " << width << "x" << height << endl;
+		return false;
+	}
+
+	if (format == RECORD_Y4M) {
+		video.open(path + ".y4m", ios::binary);
+		if (!video) {
+			cout << "FrameRecorder: can't open " << path << ".y4m" << endl;
+			return false;
+		}
+		video << "YUV4MPEG2 W" << this->width << " H" << this->height << " F" << fps << ":1 Ip A1:1 C420jpeg\n";
+	}
+
+	capturedCount = 0;
+	encodedCount = 0;
+	droppedCount = 0;
+	failedCount = 0;
+	frameCounter = 0;
+	nextIndex = 0;
+	stopping = false;
+	recording = true;
+	encoder = thread(&FrameRecorder::encodeLoop, this);
+
+	cout << "FrameRecorder: recording " << this->width << "x" << this->height << " to " << path
+		<< (format == RECORD_Y4M ? ".y4m" : "_*.png") << endl;
+	return true;
+}
+
+void FrameRecorder::stop() {
+	if (!recording)
+		return;
+	recording = false;
+
+	//the callbacks push into the queue, let them run before the encoder is told to finish
+	vector<ReadbackTicket> pending = inFlight;
+	for (ReadbackTicket ticket : pending)
+		readback.wait(ticket);
+	inFlight.clear();
+
+	{
+		lock_guard<mutex> lock(queueMutex);
+		stopping = true;
+	}
+	queueReady.notify_one();
+	encoder.join();
+	if (video.is_open())
+		video.close();
+
+	cout << "FrameRecorder: " << encodedCount << " frames written, " << droppedCount << " dropped, "
+		<< failedCount << " failed" << endl;
+}
+
+void FrameRecorder::capture(GLuint fbo, GLenum attachment) {
+	if (!recording)
+		return;
+	if (frameCounter++ % every)
+		return;
+
+	//backpressure: never let the reads in flight plus the queue outgrow the capacity
+	size_t queued;
+	{
+		lock_guard<mutex> lock(queueMutex);
+		queued = queue.size();
+	}
+	if ((int)(queued + inFlight.size()) >= queueCapacity) {
+		droppedCount++;
+		return;
+	}
+
+	int index = nextIndex++;
+	ReadbackTicket ticket = readback.request(fbo, attachment, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
+		[this, index](const ReadbackResult& result) {
+			inFlight.erase(remove(inFlight.begin(), inFlight.end(), result.ticket), inFlight.end());
+
+			const unsigned char* pixels = (const unsigned char*)result.data;
+			Frame frame;
+			frame.index = index;
+			frame.pixels.assign(pixels, pixels + result.size);
+			{
+				lock_guard<mutex> lock(queueMutex);
+				queue.push_back(move(frame));
+			}
+			queueReady.notify_one();
+		});
+	if (!ticket) {
+		failedCount++;
+		return;
+	}
+	inFlight.push_back(ticket);
+	capturedCount++;
+}
+
+void FrameRecorder::encodeLoop() {
+	PROFILE_THREAD("encoder");
+	while (true) {
+		Frame frame;
+		{
+			unique_lock<mutex> lock(queueMutex);
+			queueReady.wait(lock, [this] { return stopping || !queue.empty(); });
+			if (queue.empty())
+				return;
+			frame = move(queue.front());
+			queue.pop_front();
+		}
+		writeFrame(frame);
+	}
+}
+
+void FrameRecorder::writeFrame(Frame& frame) {
+	PROFILE_FUNCTION();
+	cv::Mat rgba(height, width, CV_8UC4, frame.pixels.data());
+	//GL rows start at the bottom
+	cv::flip(rgba, rgba, 0);
+
+	if (format == RECORD_PNG) {
+		cv::Mat bgr;
+		cv::cvtColor(rgba, bgr, cv::COLOR_RGBA2BGR);
+		char name[32];
+		snprintf(name, sizeof(name), "_%05d.png", frame.index);
+		if (!cv::imwrite(path + name, bgr)) {
+			failedCount++;
+			return;
+		}
+	}
+	else {
+		cv::Mat yuv;
+		cv::cvtColor(rgba, yuv, cv::COLOR_RGBA2YUV_I420);
+		video << "FRAME\n";
+		video.write((const char*)yuv.data, yuv.total() * yuv.elemSize());
+		if (!video) {
+			failedCount++;
+			return;
+		}
+	}
+	encodedCount++;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include<iostream>
+#include<fstream>
+#include<vector>
+#include<deque>
+#include<string>
+#include<thread>
+#include<atomic>
+#include<mutex>
+#include<condition_variable>
+
+#include "AsyncReadback.h"
+
+using namespace std;
+
+enum RecordFormat
+{
+	RECORD_PNG = 0,		//<path>_00000.png, one file per frame
+	RECORD_Y4M = 1,		//<path>.y4m, raw 4:2:0 video
+};
+
+//Records rendered frames without touching the frame timing.
+//capture() only queues an AsyncReadback; the readback callback moves the pixels into
+//a bounded queue and an encoder thread writes them out. When the queue (plus the reads
+//in flight) is full the frame is dropped and counted instead of waiting for the encoder.
+class FrameRecorder
+{
+public:
+	FrameRecorder(AsyncReadback& readback, int queueCapacity = 8);
+	~FrameRecorder();
+
+	//width/height are rounded down to even sizes (4:2:0), every = record every Nth capture()
+	bool start(const string& path, RecordFormat format, int width, int height, int every = 1, int fps = 30);
+	//finish the reads in flight, write what is queued and close the output
+	void stop();
+	bool isRecording() const	{ return recording; }
+
+	//call once per frame when the frame is complete in attachment of fbo (0/GL_BACK for the window)
+	void capture(GLuint fbo, GLenum attachment);
+
+	int getWidth() const		{ return width; }
+	int getHeight() const		{ return height; }
+
+	//counters of the current/last recording, the encoder thread updates them too
+	atomic<int> capturedCount{ 0 };		//readbacks queued
+	atomic<int> encodedCount{ 0 };		//frames written
+	atomic<int> droppedCount{ 0 };		//frames skipped because the encoder fell behind
+	atomic<int> failedCount{ 0 };		//readbacks refused or frames that could not be written
+
+private:
+	struct Frame
+	{
+		int index;
+		vector<unsigned char> pixels;	//RGBA, bottom row first
+	};
+
+	void encodeLoop();
+	void writeFrame(Frame& frame);
+
+	AsyncReadback& readback;
+	int queueCapacity;
+
+	bool recording = false;
+	string path;
+	RecordFormat format = RECORD_PNG;
+	int width = 0;
+	int height = 0;
+	int every = 1;
+	int frameCounter = 0;
+	int nextIndex = 0;
+	vector<ReadbackTicket> inFlight;	//main thread only
+	ofstream video;						//encoder thread only while recording
+
+	thread encoder;
+	mutex queueMutex;
+	condition_variable queueReady;
+	deque<Frame> queue;
+	bool stopping = false;
+};
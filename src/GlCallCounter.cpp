@@ -0,0 +1,221 @@
+#include "GlCallCounter.h"
+#include <algorithm>
+
+bool GlCallCounter::installed = false;
+thread_local bool GlCallCounter::countingThread = false;
+vector<GlEntryPoint*> GlCallCounter::entryPoints;
+GlCallStats GlCallCounter::lastFrame;
+bool GlCallCounter::logging = false;
+string GlCallCounter::logPath;
+bool GlCallCounter::logRequested = false;
+vector<GlEntryPoint*> GlCallCounter::log;
+
+GlEntryPoint* GlCallCounter::addEntryPoint(const char* name, GlCallKind kind) {
+	GlEntryPoint* entry = new GlEntryPoint();
+	entry->name = name;
+	entry->kind = kind;
+	entryPoints.push_back(entry);
+	return entry;
+}
+
+#ifdef WATERSURFACE_GL_TRACE
+
+//one instance per hooked function (Id keeps functions of the same signature apart)
+template<int Id, typename R, typename... Args>
+struct GlTrampoline
+{
+	typedef R (APIENTRYP Function)(Args...);
+	static Function original;
+	static GlEntryPoint* entry;
+
+	static R APIENTRY call(Args... args) {
+		GlCallCounter::record(*entry);
+		return original(args...);
+	}
+};
+
+template<int Id, typename R, typename... Args>
+typename GlTrampoline<Id, R, Args...>::Function GlTrampoline<Id, R, Args...>::original = nullptr;
+template<int Id, typename R, typename... Args>
+GlEntryPoint* GlTrampoline<Id, R, Args...>::entry = nullptr;
+
+template<int Id, typename R, typename... Args>
+static void hook(R (APIENTRYP& pointer)(Args...), const char* name, GlCallKind kind) {
+	//not in this context, leave it null so a call still fails the same way
+	if (!pointer)
+		return;
+	GlTrampoline<Id, R, Args...>::original = pointer;
+	GlTrampoline<Id, R, Args...>::entry = GlCallCounter::addEntryPoint(name, kind);
+	pointer = &GlTrampoline<Id, R, Args...>::call;
+}
+
+//one per line, __LINE__ is the trampoline id
+#define GL_HOOK(function, kind) hook<__LINE__>(glad_##function, #function, kind)
+
+bool GlCallCounter::install() {
+	if (installed)
+		return true;
+
+	GL_HOOK(glDrawArrays, GL_CALL_DRAW);
+	GL_HOOK(glDrawElements, GL_CALL_DRAW);
+	GL_HOOK(glDrawArraysInstanced, GL_CALL_DRAW);
+	GL_HOOK(glDrawElementsInstanced, GL_CALL_DRAW);
+	GL_HOOK(glDrawElementsBaseVertex, GL_CALL_DRAW);
+	GL_HOOK(glMultiDrawElementsIndirect, GL_CALL_DRAW);
+	GL_HOOK(glBegin, GL_CALL_DRAW);
+	GL_HOOK(glClear, GL_CALL_DRAW);
+	GL_HOOK(glClearBufferfv, GL_CALL_DRAW);
+	GL_HOOK(glBlitFramebuffer, GL_CALL_DRAW);
+
+	GL_HOOK(glBindBuffer, GL_CALL_BIND);
+	GL_HOOK(glBindBufferBase, GL_CALL_BIND);
+	GL_HOOK(glBindBufferRange, GL_CALL_BIND);
+	GL_HOOK(glBindVertexArray, GL_CALL_BIND);
+	GL_HOOK(glBindTexture, GL_CALL_BIND);
+	GL_HOOK(glActiveTexture, GL_CALL_BIND);
+	GL_HOOK(glBindFramebuffer, GL_CALL_BIND);
+	GL_HOOK(glBindRenderbuffer, GL_CALL_BIND);
+	GL_HOOK(glUseProgram, GL_CALL_BIND);
+
+	GL_HOOK(glUniform1i, GL_CALL_UNIFORM);
+	GL_HOOK(glUniform1f, GL_CALL_UNIFORM);
+	GL_HOOK(glUniform2f, GL_CALL_UNIFORM);
+	GL_HOOK(glUniform2fv, GL_CALL_UNIFORM);
+	GL_HOOK(glUniform3f, GL_CALL_UNIFORM);
+	GL_HOOK(glUniform3fv, GL_CALL_UNIFORM);
+	GL_HOOK(glUniform4f, GL_CALL_UNIFORM);
+	GL_HOOK(glUniform4fv, GL_CALL_UNIFORM);
+	GL_HOOK(glUniformMatrix2fv, GL_CALL_UNIFORM);
+	GL_HOOK(glUniformMatrix3fv, GL_CALL_UNIFORM);
+	GL_HOOK(glUniformMatrix4fv, GL_CALL_UNIFORM);
+
+	GL_HOOK(glBufferData, GL_CALL_UPLOAD);
+	GL_HOOK(glBufferSubData, GL_CALL_UPLOAD);
+	GL_HOOK(glBufferStorage, GL_CALL_UPLOAD);
+	GL_HOOK(glTexImage2D, GL_CALL_UPLOAD);
+	GL_HOOK(glTexSubImage2D, GL_CALL_UPLOAD);
+	GL_HOOK(glTexSubImage3D, GL_CALL_UPLOAD);
+	GL_HOOK(glTexStorage2D, GL_CALL_UPLOAD);
+	GL_HOOK(glTexStorage3D, GL_CALL_UPLOAD);
+	GL_HOOK(glGenerateMipmap, GL_CALL_UPLOAD);
+
+	GL_HOOK(glEnable, GL_CALL_STATE);
+	GL_HOOK(glDisable, GL_CALL_STATE);
+	GL_HOOK(glBlendFunc, GL_CALL_STATE);
+	GL_HOOK(glDepthFunc, GL_CALL_STATE);
+	GL_HOOK(glDepthMask, GL_CALL_STATE);
+	GL_HOOK(glStencilFunc, GL_CALL_STATE);
+	GL_HOOK(glStencilOp, GL_CALL_STATE);
+	GL_HOOK(glStencilMask, GL_CALL_STATE);
+	GL_HOOK(glViewport, GL_CALL_STATE);
+	GL_HOOK(glClearColor, GL_CALL_STATE);
+	GL_HOOK(glTexParameteri, GL_CALL_STATE);
+	GL_HOOK(glTexParameterf, GL_CALL_STATE);
+	GL_HOOK(glVertexAttribPointer, GL_CALL_STATE);
+	GL_HOOK(glVertexAttribIPointer, GL_CALL_STATE);
+	GL_HOOK(glVertexAttribDivisor, GL_CALL_STATE);
+	GL_HOOK(glEnableVertexAttribArray, GL_CALL_STATE);
+	GL_HOOK(glPixelStorei, GL_CALL_STATE);
+
+	GL_HOOK(glGetIntegerv, GL_CALL_SYNC);
+	GL_HOOK(glGetFloatv, GL_CALL_SYNC);
+	GL_HOOK(glGetError, GL_CALL_SYNC);
+	GL_HOOK(glGetUniformLocation, GL_CALL_SYNC);
+	GL_HOOK(glGetQueryObjectiv, GL_CALL_SYNC);
+	GL_HOOK(glGetQueryObjectui64v, GL_CALL_SYNC);
+	GL_HOOK(glGetTexImage, GL_CALL_SYNC);
+	GL_HOOK(glCheckFramebufferStatus, GL_CALL_SYNC);
+	GL_HOOK(glReadPixels, GL_CALL_SYNC);
+	GL_HOOK(glMapBufferRange, GL_CALL_SYNC);
+	GL_HOOK(glClientWaitSync, GL_CALL_SYNC);
+	GL_HOOK(glFinish, GL_CALL_SYNC);
+
+	GL_HOOK(glGenBuffers, GL_CALL_OTHER);
+	GL_HOOK(glDeleteBuffers, GL_CALL_OTHER);
+	GL_HOOK(glGenTextures, GL_CALL_OTHER);
+	GL_HOOK(glDeleteTextures, GL_CALL_OTHER);
+	GL_HOOK(glGenVertexArrays, GL_CALL_OTHER);
+	GL_HOOK(glFenceSync, GL_CALL_OTHER);
+	GL_HOOK(glDeleteSync, GL_CALL_OTHER);
+	GL_HOOK(glQueryCounter, GL_CALL_OTHER);
+
+	installed = true;
+	countingThread = true;
+	cout << "GlCallCounter: " << entryPoints.size() << " GL functions hooked" << endl;
+	return true;
+}
+
+#else
+
+bool GlCallCounter::install() {
+	return false;
+}
+
+#endif
+
+void GlCallCounter::beginFrame() {
+	if (!installed)
+		return;
+	//calls between frames (loading, the overlay) are not part of any frame
+	for (GlEntryPoint* entry : entryPoints) {
+		entry->totalCalls += entry->calls;
+		entry->calls = 0;
+	}
+	if (logRequested) {
+		logRequested = false;
+		logging = true;
+		log.clear();
+	}
+}
+
+void GlCallCounter::endFrame() {
+	if (!installed)
+		return;
+
+	lastFrame = GlCallStats();
+	for (GlEntryPoint* entry : entryPoints) {
+		entry->lastFrameCalls = entry->calls;
+		lastFrame.calls[entry->kind] += entry->calls;
+		lastFrame.total += entry->calls;
+	}
+
+	if (logging) {
+		logging = false;
+		ofstream file(logPath);
+		if (!file) {
+			cout << "GlCallCounter: can't write " << logPath << endl;
+			return;
+		}
+		for (GlEntryPoint* entry : log)
+			file << entry->name << (entry->kind == GL_CALL_SYNC ? "\t[sync]" : "") << "\n";
+		cout << "GlCallCounter: " << log.size() << " calls written to " << logPath << endl;
+		log.clear();
+	}
+}
+
+void GlCallCounter::logNextFrame(const string& path) {
+	if (!installed) {
+		cout << "GlCallCounter: not compiled in (WATERSURFACE_GL_TRACE)" << endl;
+		return;
+	}
+	logPath = path;
+	logRequested = true;
+}
+
+void GlCallCounter::printLastFrame() {
+	if (!installed)
+		return;
+
+	vector<GlEntryPoint*> sorted;
+	for (GlEntryPoint* entry : entryPoints)
+		if (entry->lastFrameCalls)
+			sorted.push_back(entry);
+	sort(sorted.begin(), sorted.end(),
+		[](const GlEntryPoint* a, const GlEntryPoint* b) { return a->lastFrameCalls > b->lastFrameCalls; });
+
+	for (int i = 0; i < GL_CALL_KIND_COUNT; i++)
+		cout << glCallKindNames[i] << " " << lastFrame.calls[i] << "  ";
+	cout << "total " << lastFrame.total << endl;
+	for (GlEntryPoint* entry : sorted)
+		cout << "  " << entry->name << " " << entry->lastFrameCalls << (entry->kind == GL_CALL_SYNC ? " (sync)" : "") << endl;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include<iostream>
+#include<fstream>
+#include<vector>
+#include<string>
+
+#include <glad/glad.h>
+
+using namespace std;
+
+enum GlCallKind
+{
+	GL_CALL_DRAW = 0,	//draws, clears, blits
+	GL_CALL_BIND,		//buffers, textures, vertex arrays, framebuffers, programs
+	GL_CALL_UNIFORM,	//glUniform*
+	GL_CALL_UPLOAD,		//buffer and texture data
+	GL_CALL_STATE,		//enables, blend/depth/stencil, viewport, attributes, texture parameters
+	GL_CALL_SYNC,		//calls that can wait for the driver or the GPU: glGet*, glReadPixels, glFinish, maps
+	GL_CALL_OTHER,		//object creation and deletion, fences, queries
+	GL_CALL_KIND_COUNT
+};
+
+static const char* const glCallKindNames[GL_CALL_KIND_COUNT] = {
+	"draw", "bind", "uniform", "upload", "state", "sync", "other" };
+
+//one hooked GL function
+struct GlEntryPoint
+{
+	const char* name;
+	GlCallKind kind;
+	unsigned int calls = 0;			//this frame
+	unsigned int lastFrameCalls = 0;
+	unsigned long long totalCalls = 0;
+};
+
+struct GlCallStats
+{
+	unsigned int calls[GL_CALL_KIND_COUNT] = {};
+	unsigned int total = 0;
+};
+
+//Counts GL calls per frame by entry point. install() swaps the glad_gl* pointers of the
+//functions the passes use for trampolines that count the call and forward it, so every
+//call site is covered without touching it. Only with the WATERSURFACE_GL_TRACE CMake
+//option; otherwise install() does nothing and all counts stay zero.
+//only the calls of the thread that installed it (the one rendering the frames) are counted,
+//the window's blits on the UI thread go through the same pointers and are skipped.
+//GL thread only.
+class GlCallCounter
+{
+public:
+	//after glad is loaded
+	static bool install();
+	static bool isInstalled()						{ return installed; }
+
+	static void beginFrame();
+	static void endFrame();
+
+	static void record(GlEntryPoint& entry) {
+		if (!countingThread)
+			return;
+		entry.calls++;
+		if (logging)
+			log.push_back(&entry);
+	}
+
+	//per kind totals of the last finished frame
+	static const GlCallStats& getLastFrame()		{ return lastFrame; }
+	static const vector<GlEntryPoint*>& getEntryPoints()	{ return entryPoints; }
+
+	//every call of the next frame, in order, sync calls marked
+	static void logNextFrame(const string& path);
+	//entry points called in the last frame, most calls first
+	static void printLastFrame();
+
+	//used by install(), owned here
+	static GlEntryPoint* addEntryPoint(const char* name, GlCallKind kind);
+
+private:
+	static bool installed;
+	static thread_local bool countingThread;
+	static vector<GlEntryPoint*> entryPoints;
+	static GlCallStats lastFrame;
+
+	static bool logging;
+	static string logPath;
+	static bool logRequested;
+	static vector<GlEntryPoint*> log;
+};
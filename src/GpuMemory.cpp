@@ -0,0 +1,115 @@
+#include "GpuMemory.h"
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+
+map<pair<GLenum, GLuint>, GpuMemory::Allocation> GpuMemory::allocations;
+GpuMemoryStats GpuMemory::stats[GPU_MEMORY_CATEGORY_COUNT];
+size_t GpuMemory::totalBytes = 0;
+size_t GpuMemory::peakBytes = 0;
+
+void GpuMemory::track(GLenum object, GLuint id, GpuMemoryCategory category, size_t bytes, const string& label) {
+	if (!id)
+		return;
+	untrack(object, id);
+
+	Allocation allocation = { category, bytes, label };
+	allocations[make_pair(object, id)] = allocation;
+
+	GpuMemoryStats& stat = stats[category];
+	stat.bytes += bytes;
+	stat.count++;
+	stat.peakBytes = max(stat.peakBytes, stat.bytes);
+	totalBytes += bytes;
+	peakBytes = max(peakBytes, totalBytes);
+}
+
+void GpuMemory::untrack(GLenum object, GLuint id) {
+	map<pair<GLenum, GLuint>, Allocation>::iterator it = allocations.find(make_pair(object, id));
+	if (it == allocations.end())
+		return;
+
+	GpuMemoryStats& stat = stats[it->second.category];
+	stat.bytes -= it->second.bytes;
+	stat.count--;
+	totalBytes -= it->second.bytes;
+	allocations.erase(it);
+}
+
+size_t GpuMemory::textureSize(GLenum format, int width, int height, int layers, bool mipmaps) {
+	//3 channel formats are padded to 4 by every driver we run on
+	size_t texel;
+	switch (format) {
+	case GL_RED:
+	case GL_R8:			texel = 1; break;
+	case GL_RG:
+	case GL_RG8:
+	case GL_R16F:		texel = 2; break;
+	case GL_RG16F:
+	case GL_R32F:
+	case GL_RGB:
+	case GL_RGB8:
+	case GL_RGBA:
+	case GL_RGBA8:
+	case GL_DEPTH_COMPONENT24:
+	case GL_DEPTH_COMPONENT32F:	texel = 4; break;
+	case GL_RGB16F:
+	case GL_RGBA16F:
+	case GL_RG32F:		texel = 8; break;
+	case GL_RGB32F:
+	case GL_RGBA32F:	texel = 16; break;
+	default:			texel = 4; break;
+	}
+
+	size_t bytes = (size_t)width * height * layers * texel;
+	if (mipmaps)
+		bytes += bytes / 3;
+	return bytes;
+}
+
+static void writeStats(ostream& out, const char* name, size_t bytes, size_t peak, int count) {
+	char line[128];
+	snprintf(line, sizeof(line), "%-14s %10.2f MB  peak %10.2f MB  %5d objects",
+		name, bytes / (1024.0 * 1024.0), peak / (1024.0 * 1024.0), count);
+	out << line << endl;
+}
+
+bool GpuMemory::dump(const string& path) {
+	ofstream file(path);
+	if (!file) {
+		cout << "GpuMemory: can't write " << path << endl;
+		return false;
+	}
+
+	int count = 0;
+	for (int i = 0; i < GPU_MEMORY_CATEGORY_COUNT; i++) {
+		writeStats(file, gpuMemoryCategoryNames[i], stats[i].bytes, stats[i].peakBytes, stats[i].count);
+		count += stats[i].count;
+	}
+	writeStats(file, "total", totalBytes, peakBytes, count);
+	file << endl;
+
+	vector<const Allocation*> sorted;
+	for (map<pair<GLenum, GLuint>, Allocation>::const_iterator it = allocations.begin(); it != allocations.end(); it++)
+		sorted.push_back(&it->second);
+	sort(sorted.begin(), sorted.end(), [](const Allocation* a, const Allocation* b) { return a->bytes > b->bytes; });
+
+	char line[64];
+	for (const Allocation* allocation : sorted) {
+		snprintf(line, sizeof(line), "%12zu  %-14s  ", allocation->bytes, gpuMemoryCategoryNames[allocation->category]);
+		file << line << allocation->label << endl;
+	}
+
+	cout << "GpuMemory: " << sorted.size() << " allocations written to " << path << endl;
+	return true;
+}
+
+void GpuMemory::printStats() {
+	int count = 0;
+	for (int i = 0; i < GPU_MEMORY_CATEGORY_COUNT; i++) {
+		writeStats(cout, gpuMemoryCategoryNames[i], stats[i].bytes, stats[i].peakBytes, stats[i].count);
+		count += stats[i].count;
+	}
+	writeStats(cout, "total", totalBytes, peakBytes, count);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include<iostream>
+#include<string>
+#include<map>
+
+#include <glad/glad.h>
+
+using namespace std;
+
+//what an allocation is for, the rows of the memory overlay and dump
+enum GpuMemoryCategory
+{
+	GPU_MEMORY_TEXTURE = 0,		//Texture2D: ground, water
+	GPU_MEMORY_HEIGHTMAP,		//the water heightmap sequence
+	GPU_MEMORY_MODEL_TEXTURE,	//TextureFromFile, static batch material arrays
+	GPU_MEMORY_CUBEMAP,			//sky box
+	GPU_MEMORY_FRAMEBUFFER,		//FrameBuffer targets, depth and MSAA buffers included
+	GPU_MEMORY_MESH,			//model vertex and index buffers
+	GPU_MEMORY_BUFFER,			//quads, instance, indirect, upload and readback buffers
+	GPU_MEMORY_CATEGORY_COUNT
+};
+
+static const char* const gpuMemoryCategoryNames[GPU_MEMORY_CATEGORY_COUNT] = {
+	"texture", "heightmap", "model texture", "cubemap", "framebuffer", "mesh", "buffer" };
+
+struct GpuMemoryStats
+{
+	size_t bytes = 0;
+	size_t peakBytes = 0;	//high-water mark
+	int count = 0;
+};
+
+//Estimated GPU memory of every GL allocation, by category.
+//the allocation paths register what they create with track() and remove it with untrack();
+//the sizes are computed from the formats, the driver's real footprint (alignment, padding) is not known.
+//GL thread only.
+class GpuMemory
+{
+public:
+	//object is GL_TEXTURE, GL_BUFFER, GL_RENDERBUFFER or GL_FRAMEBUFFER, GL names are only unique per type.
+	//tracking a name again replaces its old size (reallocated buffers)
+	static void track(GLenum object, GLuint id, GpuMemoryCategory category, size_t bytes, const string& label = "");
+	static void untrack(GLenum object, GLuint id);
+
+	static const GpuMemoryStats& getStats(GpuMemoryCategory category)	{ return stats[category]; }
+	static size_t getTotalBytes()										{ return totalBytes; }
+	static size_t getPeakBytes()										{ return peakBytes; }
+
+	//every live allocation, largest first, after the per category totals
+	static bool dump(const string& path);
+	static void printStats();
+
+	//bytes of a texture of the given (sized or unsized) internal format, a mip chain adds a third
+	static size_t textureSize(GLenum format, int width, int height, int layers = 1, bool mipmaps = false);
+
+private:
+	struct Allocation
+	{
+		GpuMemoryCategory category;
+		size_t bytes;
+		string label;
+	};
+
+	static map<pair<GLenum, GLuint>, Allocation> allocations;
+	static GpuMemoryStats stats[GPU_MEMORY_CATEGORY_COUNT];
+	static size_t totalBytes;
+	static size_t peakBytes;
+};
@@ -0,0 +1,136 @@
+#include "GpuProfiler.h"
+#include <cstring>
+
+GpuProfiler::GpuProfiler() {
+	for (FrameQueries& set : sets)
+		glGenQueries(GPU_PROFILER_MAX_ZONES * 2, set.queries);
+}
+
+GpuProfiler::~GpuProfiler() {
+	for (FrameQueries& set : sets)
+		glDeleteQueries(GPU_PROFILER_MAX_ZONES * 2, set.queries);
+}
+
+void GpuProfiler::beginFrame() {
+	inFrame = enabled;
+	if (!enabled)
+		return;
+
+	current = (int)(frameCounter % GPU_PROFILER_FRAMES);
+	FrameQueries& set = sets[current];
+
+	//the set about to be reused holds the oldest frame in flight
+	//timestamps complete in issue order, so the last one issued covers them all
+	if (set.lastIssued >= 0) {
+		GLint available = 0;
+		glGetQueryObjectiv(set.queries[set.lastIssued], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available)
+			collect(set);
+		else
+			skippedFrames++;
+	}
+
+	set.zones.clear();
+	set.used = 0;
+	set.lastIssued = -1;
+	set.frame = frameCounter++;
+	depth = 0;
+}
+
+void GpuProfiler::endFrame() {
+	inFrame = false;
+}
+
+int GpuProfiler::begin(const char* name) {
+	if (!inFrame)
+		return -1;
+	FrameQueries& set = sets[current];
+	if (set.used + 2 > GPU_PROFILER_MAX_ZONES * 2) {
+		if (!overflowReported) {
+			cout << "GpuProfiler: more than " << GPU_PROFILER_MAX_ZONES << " zones in a frame" << endl;
+			overflowReported = true;
+		}
+		return -1;
+	}
+
+	Zone zone;
+	zone.name = name;
+	zone.depth = depth++;
+	zone.beginQuery = set.used++;
+	zone.endQuery = set.used++;
+	zone.ended = false;
+	glQueryCounter(set.queries[zone.beginQuery], GL_TIMESTAMP);
+	set.lastIssued = zone.beginQuery;
+	set.zones.push_back(zone);
+	return (int)set.zones.size() - 1;
+}
+
+void GpuProfiler::end(int zone) {
+	if (!inFrame || zone < 0)
+		return;
+	FrameQueries& set = sets[current];
+	Zone& ended = set.zones[zone];
+	glQueryCounter(set.queries[ended.endQuery], GL_TIMESTAMP);
+	ended.ended = true;
+	set.lastIssued = ended.endQuery;
+	depth--;
+}
+
+bool GpuProfiler::openCsv(const string& path) {
+	//ate: tellp is the end of what an earlier run wrote, app alone may report 0
+	csv.open(path, ios::app | ios::ate);
+	if (!csv) {
+		cout << "GpuProfiler: can't write " << path << endl;
+		return false;
+	}
+	//appending to an earlier run's rows: the header is already there
+	if (csv.tellp() == 0)
+		csv << "frame,zone,depth,ms\n";
+	return true;
+}
+
+void GpuProfiler::closeCsv() {
+	csv.close();
+}
+
+void GpuProfiler::collect(FrameQueries& set) {
+	results.clear();
+	for (const Zone& zone : set.zones) {
+		//its end query was never issued, reading it would wait forever
+		if (!zone.ended)
+			continue;
+		GLuint64 beginTime = 0, endTime = 0;
+		glGetQueryObjectui64v(set.queries[zone.beginQuery], GL_QUERY_RESULT, &beginTime);
+		glGetQueryObjectui64v(set.queries[zone.endQuery], GL_QUERY_RESULT, &endTime);
+		results.push_back({ zone.name, zone.depth, (endTime - beginTime) / 1000000.0f });
+	}
+
+	//rolling history, zones are found by name so passes that come and go keep their row
+	for (GpuZoneHistory& row : history)
+		row.ms[historyHead] = 0;
+	for (const GpuZoneResult& result : results) {
+		GpuZoneHistory* row = nullptr;
+		for (GpuZoneHistory& candidate : history)
+			if (candidate.name == result.name || !strcmp(candidate.name, result.name))
+				row = &candidate;
+		if (!row) {
+			history.push_back(GpuZoneHistory());
+			row = &history.back();
+			row->name = result.name;
+			row->depth = result.depth;
+		}
+		row->ms[historyHead] += result.ms;
+	}
+	historyHead = (historyHead + 1) % GPU_PROFILER_HISTORY;
+	for (GpuZoneHistory& row : history) {
+		float sum = 0;
+		for (float ms : row.ms)
+			sum += ms;
+		row.average = sum / GPU_PROFILER_HISTORY;
+	}
+
+	if (csv.is_open()) {
+		for (const GpuZoneResult& result : results)
+			csv << set.frame << "," << result.name << "," << result.depth << "," << result.ms << "\n";
+	}
+}
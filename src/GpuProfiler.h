@@ -0,0 +1,108 @@
+#pragma once
+#include<iostream>
+#include<fstream>
+#include<vector>
+#include<string>
+
+#include <glad/glad.h>
+
+using namespace std;
+
+//frames of queries in flight, results are read GPU_PROFILER_FRAMES - 1 frames late
+#define GPU_PROFILER_FRAMES 3
+#define GPU_PROFILER_MAX_ZONES 32
+//frames kept for the rolling overlay
+#define GPU_PROFILER_HISTORY 120
+
+//GPU time of one zone of a finished frame
+struct GpuZoneResult
+{
+	const char* name;
+	int depth;			//nesting level, 0 = outermost
+	float ms;
+};
+
+//rolling times of a zone, by name
+struct GpuZoneHistory
+{
+	const char* name;
+	int depth;
+	float ms[GPU_PROFILER_HISTORY] = {};
+	float average = 0;
+};
+
+//Times named zones of the frame on the GPU with GL_TIMESTAMP queries.
+//Every zone writes a timestamp at begin() and end(), so zones can nest (GL_TIME_ELAPSED can't).
+//Queries rotate over GPU_PROFILER_FRAMES sets; beginFrame() reads the set issued that many
+//frames ago only if the GPU already has the results, otherwise that frame is skipped,
+//so reading never stalls.
+class GpuProfiler
+{
+public:
+	GpuProfiler();
+	~GpuProfiler();
+
+	void beginFrame();
+	void endFrame();
+
+	//name must be a string literal (kept by pointer)
+	int begin(const char* name);
+	void end(int zone);
+
+	//zones of the last finished frame, in begin() order
+	const vector<GpuZoneResult>& getResults() const		{ return results; }
+	const vector<GpuZoneHistory>& getHistory() const	{ return history; }
+	//oldest entry of GpuZoneHistory::ms
+	int getHistoryHead() const							{ return historyHead; }
+	int getSkippedFrames() const						{ return skippedFrames; }
+
+	//append "frame,zone,depth,ms" rows for every finished frame
+	bool openCsv(const string& path);
+	void closeCsv();
+	bool isWritingCsv() const							{ return csv.is_open(); }
+
+	bool enabled = true;
+
+private:
+	struct Zone
+	{
+		const char* name;
+		int depth;
+		int beginQuery;
+		int endQuery;
+		bool ended;
+	};
+	struct FrameQueries
+	{
+		GLuint queries[GPU_PROFILER_MAX_ZONES * 2];
+		vector<Zone> zones;
+		int used = 0;
+		int lastIssued = -1;	//query of the last glQueryCounter, the outer zones end last
+		long long frame = -1;
+	};
+
+	void collect(FrameQueries& set);
+
+	FrameQueries sets[GPU_PROFILER_FRAMES];
+	int current = 0;
+	long long frameCounter = 0;
+	int depth = 0;
+	bool inFrame = false;
+	bool overflowReported = false;
+
+	vector<GpuZoneResult> results;
+	vector<GpuZoneHistory> history;
+	int historyHead = 0;
+	int skippedFrames = 0;
+	ofstream csv;
+};
+
+//times the enclosing block, does nothing without a profiler
+struct GpuScope
+{
+	GpuScope(GpuProfiler* profiler, const char* name) : profiler(profiler), zone(profiler ? profiler->begin(name) : -1) {}
+	~GpuScope() { if (profiler) profiler->end(zone); }
+
+	GpuProfiler* profiler;
+	int zone;
+};
@@ -0,0 +1,161 @@
+#include "HeadlessContext.h"
+
+#if defined(HEADLESS_EGL)
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#elif defined(HEADLESS_OSMESA)
+#include <GL/osmesa.h>
+#endif
+
+HeadlessContext::~HeadlessContext() {
+	destroy();
+}
+
+#if defined(HEADLESS_EGL)
+
+//surfaceless, the size only matters to the FBOs the passes create
+bool HeadlessContext::create(int, int) {
+	//the surfaceless platform needs no display server and no window
+	EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay)
+		eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	if (eglDisplay == EGL_NO_DISPLAY)
+		eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor;
+	if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor)) {
+		cout << "HeadlessContext: no EGL display" << endl;
+		return false;
+	}
+	display = eglDisplay;
+
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		cout << "HeadlessContext: EGL has no desktop OpenGL" << endl;
+		return false;
+	}
+
+	const EGLint configAttribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+		EGL_DEPTH_SIZE, 24, EGL_STENCIL_SIZE, 8,
+		EGL_NONE };
+	EGLConfig config;
+	EGLint configCount = 0;
+	if (!eglChooseConfig(eglDisplay, configAttribs, &config, 1, &configCount) || configCount == 0) {
+		cout << "HeadlessContext: no EGL config" << endl;
+		return false;
+	}
+
+	//the passes use the fixed function stack (compatibility) and glBufferStorage (4.4)
+	const int versions[][2] = { { 4, 6 }, { 4, 5 }, { 4, 4 } };
+	for (const int* version : versions) {
+		const EGLint contextAttribs[] = {
+			EGL_CONTEXT_MAJOR_VERSION, version[0],
+			EGL_CONTEXT_MINOR_VERSION, version[1],
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+			EGL_NONE };
+		context = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttribs);
+		if (context)
+			break;
+	}
+	if (!context) {
+		cout << "HeadlessContext: can't create an OpenGL 4.4 compatibility context" << endl;
+		return false;
+	}
+
+	//surfaceless: every pass renders into FBOs
+	if (!eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, (EGLContext)context)) {
+		cout << "HeadlessContext: eglMakeCurrent failed" << endl;
+		return false;
+	}
+	return true;
+}
+
+void HeadlessContext::destroy() {
+	if (!display)
+		return;
+	eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (context)
+		eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+	eglTerminate((EGLDisplay)display);
+	context = nullptr;
+	display = nullptr;
+}
+
+GLADloadproc HeadlessContext::getLoader() const {
+	return (GLADloadproc)eglGetProcAddress;
+}
+
+const char* HeadlessContext::getBackendName() const {
+	return "EGL";
+}
+
+#elif defined(HEADLESS_OSMESA)
+
+bool HeadlessContext::create(int width, int height) {
+	const int versions[][2] = { { 4, 6 }, { 4, 5 }, { 4, 4 } };
+	for (const int* version : versions) {
+		const int attribs[] = {
+			OSMESA_FORMAT, OSMESA_RGBA,
+			OSMESA_DEPTH_BITS, 24,
+			OSMESA_STENCIL_BITS, 8,
+			OSMESA_PROFILE, OSMESA_COMPAT_PROFILE,
+			OSMESA_CONTEXT_MAJOR_VERSION, version[0],
+			OSMESA_CONTEXT_MINOR_VERSION, version[1],
+			0 };
+		context = OSMesaCreateContextAttribs(attribs, nullptr);
+		if (context)
+			break;
+	}
+	if (!context) {
+		cout << "HeadlessContext: can't create an OSMesa 4.4 compatibility context" << endl;
+		return false;
+	}
+
+	//OSMesa always draws into client memory, even if the passes only use FBOs
+	buffer.resize((size_t)width * height * 4);
+	if (!OSMesaMakeCurrent((OSMesaContext)context, buffer.data(), GL_UNSIGNED_BYTE, width, height)) {
+		cout << "HeadlessContext: OSMesaMakeCurrent failed" << endl;
+		return false;
+	}
+	return true;
+}
+
+void HeadlessContext::destroy() {
+	if (context)
+		OSMesaDestroyContext((OSMesaContext)context);
+	context = nullptr;
+}
+
+GLADloadproc HeadlessContext::getLoader() const {
+	return (GLADloadproc)OSMesaGetProcAddress;
+}
+
+const char* HeadlessContext::getBackendName() const {
+	return "OSMesa";
+}
+
+#else
+
+bool HeadlessContext::create(int, int) {
+	cout << "HeadlessContext: built without a headless backend (HEADLESS_EGL or HEADLESS_OSMESA)" << endl;
+	return false;
+}
+
+void HeadlessContext::destroy() {
+}
+
+GLADloadproc HeadlessContext::getLoader() const {
+	return nullptr;
+}
+
+const char* HeadlessContext::getBackendName() const {
+	return "none";
+}
+
+#endif
@@ -0,0 +1,35 @@
+#pragma once
+#include<iostream>
+#include<vector>
+
+#include <glad/glad.h>
+
+using namespace std;
+
+//OpenGL context without a window, for runs on machines without a display.
+//the backend is picked at build time (WATERSURFACE_HEADLESS_BACKEND):
+//	HEADLESS_EGL	EGL surfaceless platform (Mesa, NVIDIA), no default framebuffer
+//	HEADLESS_OSMESA	OSMesa software rendering (llvmpipe), draws into a malloc'd buffer
+//either way the frames are rendered into FrameBuffers, the default framebuffer is not used.
+class HeadlessContext
+{
+public:
+	~HeadlessContext();
+
+	//create a compatibility profile context of at least 4.4 and make it current
+	bool create(int width, int height);
+	void destroy();
+
+	//for TrainView::initGL
+	GLADloadproc getLoader() const;
+	const char* getBackendName() const;
+
+private:
+#if defined(HEADLESS_EGL)
+	void* display = nullptr;	//EGLDisplay
+	void* context = nullptr;	//EGLContext
+#elif defined(HEADLESS_OSMESA)
+	void* context = nullptr;	//OSMesaContext
+	vector<unsigned char> buffer;
+#endif
+};
@@ -0,0 +1,207 @@
+#include "InputLog.h"
+#include <iterator>
+#include <cstring>
+
+#define INPUT_LOG_MAGIC 0x4C495357u	//"WSIL"
+#define INPUT_LOG_VERSION 1
+
+//record tags
+enum InputLogRecord
+{
+	INPUT_RECORD_EVENT = 1,
+	INPUT_RECORD_FRAME,
+	INPUT_RECORD_SETTINGS,
+	INPUT_RECORD_DROP
+};
+
+template<typename T>
+static void writeValue(ofstream& file, const T& value) {
+	file.write((const char*)&value, sizeof(T));
+}
+
+//reads from the loaded log, false past its end
+struct LogReader
+{
+	const vector<char>& bytes;
+	size_t offset = 0;
+
+	LogReader(const vector<char>& bytes) : bytes(bytes) {}
+
+	template<typename T>
+	bool read(T& value) {
+		if (offset + sizeof(T) > bytes.size())
+			return false;
+		memcpy(&value, &bytes[offset], sizeof(T));
+		offset += sizeof(T);
+		return true;
+	}
+};
+
+//only what comes from the widgets, the rest is the runner's
+static bool sameSettings(const RenderSettings& a, const RenderSettings& b) {
+	return a.width == b.width && a.height == b.height &&
+		a.worldCam == b.worldCam && a.topCam == b.topCam && a.trainCam == b.trainCam &&
+		a.lightType == b.lightType && a.waveType == b.waveType &&
+		a.waterAmplitude == b.waterAmplitude && a.waterWaveLength == b.waterWaveLength && a.waterSpeed == b.waterSpeed &&
+		a.pixelation == b.pixelation && a.offset == b.offset && a.grayscale == b.grayscale;
+}
+
+bool InputLog::startRecording(const string& path, const InputLogStart& start) {
+	stopRecording();
+	file.open(path, ios::binary);
+	if (!file) {
+		cout << "InputLog: can't write " << path << endl;
+		return false;
+	}
+	writeValue(file, (uint32_t)INPUT_LOG_MAGIC);
+	writeValue(file, (uint32_t)INPUT_LOG_VERSION);
+	writeValue(file, start.position);
+	writeValue(file, start.yaw);
+	writeValue(file, start.pitch);
+	settingsWritten = false;
+	recordedFrames = 0;
+	return true;
+}
+
+void InputLog::stopRecording() {
+	if (!file.is_open())
+		return;
+	file.close();
+	cout << "InputLog: " << recordedFrames << " frames recorded" << endl;
+}
+
+void InputLog::recordEvent(const InputEvent& event) {
+	if (!file.is_open())
+		return;
+	writeValue(file, (uint8_t)INPUT_RECORD_EVENT);
+	writeValue(file, event.event);
+	writeValue(file, event.button);
+	writeValue(file, event.x);
+	writeValue(file, event.y);
+	writeValue(file, event.key);
+	writeValue(file, event.state);
+}
+
+void InputLog::writeSettings(const RenderSettings& settings) {
+	writeValue(file, (uint8_t)INPUT_RECORD_SETTINGS);
+	writeValue(file, (int32_t)settings.width);
+	writeValue(file, (int32_t)settings.height);
+	uint8_t flags = (settings.worldCam ? 1 : 0) | (settings.topCam ? 2 : 0) | (settings.trainCam ? 4 : 0) |
+		(settings.pixelation ? 8 : 0) | (settings.offset ? 16 : 0) | (settings.grayscale ? 32 : 0);
+	writeValue(file, flags);
+	writeValue(file, (uint8_t)settings.lightType);
+	writeValue(file, (uint8_t)settings.waveType);
+	writeValue(file, settings.waterAmplitude);
+	writeValue(file, settings.waterWaveLength);
+	writeValue(file, settings.waterSpeed);
+}
+
+void InputLog::recordFrame(float deltaTime, const RenderSettings& settings) {
+	if (!file.is_open())
+		return;
+	if (!settingsWritten || !sameSettings(settings, lastSettings)) {
+		writeSettings(settings);
+		lastSettings = settings;
+		settingsWritten = true;
+	}
+	writeValue(file, (uint8_t)INPUT_RECORD_FRAME);
+	writeValue(file, deltaTime);
+	recordedFrames++;
+}
+
+void InputLog::recordDrop(const glm::vec2& uv) {
+	if (!file.is_open())
+		return;
+	writeValue(file, (uint8_t)INPUT_RECORD_DROP);
+	writeValue(file, uv);
+}
+
+bool InputLog::startReplay(const string& path, InputLogStart& start) {
+	stopReplay();
+	ifstream input(path, ios::binary);
+	if (!input) {
+		cout << "InputLog: can't open " << path << endl;
+		return false;
+	}
+	vector<char> bytes((istreambuf_iterator<char>(input)), istreambuf_iterator<char>());
+	LogReader reader(bytes);
+
+	uint32_t magic = 0, version = 0;
+	if (!reader.read(magic) || !reader.read(version) || magic != INPUT_LOG_MAGIC || version != INPUT_LOG_VERSION) {
+		cout << "InputLog: " << path << " is not a version " << INPUT_LOG_VERSION << " input log" << endl;
+		return false;
+	}
+	if (!reader.read(start.position) || !reader.read(start.yaw) || !reader.read(start.pitch)) {
+		cout << "InputLog: " << path << " is truncated" << endl;
+		return false;
+	}
+
+	//events before a frame record belong to it, drops after it
+	RenderSettings settings;
+	InputFrame pending;
+	uint8_t tag;
+	bool ok = true;
+	while (ok && reader.read(tag)) {
+		if (tag == INPUT_RECORD_EVENT) {
+			InputEvent event;
+			ok = reader.read(event.event) && reader.read(event.button) && reader.read(event.x) &&
+				reader.read(event.y) && reader.read(event.key) && reader.read(event.state);
+			if (ok)
+				pending.events.push_back(event);
+		}
+		else if (tag == INPUT_RECORD_SETTINGS) {
+			int32_t width, height;
+			uint8_t flags, lightType, waveType;
+			ok = reader.read(width) && reader.read(height) && reader.read(flags) && reader.read(lightType) &&
+				reader.read(waveType) && reader.read(settings.waterAmplitude) &&
+				reader.read(settings.waterWaveLength) && reader.read(settings.waterSpeed);
+			settings.width = width;
+			settings.height = height;
+			settings.worldCam = (flags & 1) != 0;
+			settings.topCam = (flags & 2) != 0;
+			settings.trainCam = (flags & 4) != 0;
+			settings.pixelation = (flags & 8) != 0;
+			settings.offset = (flags & 16) != 0;
+			settings.grayscale = (flags & 32) != 0;
+			settings.lightType = lightType;
+			settings.waveType = waveType;
+		}
+		else if (tag == INPUT_RECORD_FRAME) {
+			ok = reader.read(pending.deltaTime);
+			if (!ok)
+				break;
+			pending.settings = settings;
+			frames.push_back(pending);
+			pending = InputFrame();
+		}
+		else if (tag == INPUT_RECORD_DROP && !frames.empty()) {
+			glm::vec2 uv;
+			ok = reader.read(uv);
+			frames.back().drops.push_back(uv);
+		}
+		else
+			ok = false;
+	}
+	if (!ok)
+		cout << "InputLog: " << path << " is damaged after frame " << frames.size() << ", replaying up to there" << endl;
+
+	replayFrame = 0;
+	replaying = !frames.empty();
+	cout << "InputLog: replaying " << frames.size() << " frames of " << path << endl;
+	return replaying;
+}
+
+void InputLog::stopReplay() {
+	frames.clear();
+	replayFrame = 0;
+	replaying = false;
+}
+
+bool InputLog::nextFrame(InputFrame& frame) {
+	if (!replaying || replayFrame >= frames.size()) {
+		stopReplay();
+		return false;
+	}
+	frame = frames[replayFrame++];
+	return true;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include<iostream>
+#include<fstream>
+#include<vector>
+#include<string>
+#include<cstdint>
+
+#include <glm/glm.hpp>
+
+#include "RenderSettings.h"
+
+using namespace std;
+
+//the FlTk event state TrainView::handleInput() reads, copied when the event happens
+struct InputEvent
+{
+	uint8_t event = 0;		//FL_PUSH, FL_RELEASE, FL_DRAG, FL_KEYBOARD, FL_KEYUP
+	uint8_t button = 0;		//Fl::event_button()
+	int16_t x = 0;			//Fl::event_x(), Fl::event_y()
+	int16_t y = 0;
+	int32_t key = 0;		//Fl::event_key()
+	int32_t state = 0;		//Fl::event_state()
+};
+
+//what happened before and during one recorded frame
+struct InputFrame
+{
+	vector<InputEvent> events;		//handled before the frame was drawn
+	float deltaTime = 0.0f;
+	RenderSettings settings;		//the widgets' state of the frame
+	vector<glm::vec2> drops;		//picked water drops that landed during the frame
+};
+
+//where the camera was when the recording started
+struct InputLogStart
+{
+	glm::vec3 position;
+	float yaw;
+	float pitch;
+};
+
+//Records TrainView input to a compact binary log and plays it back frame by frame.
+//The log is a header and a stream of tagged records: events, frame delta times, widget settings
+//(only when they change) and the uv of water drops. Drops are recorded as their result because
+//the pick readback lands a frame or two late depending on the GPU; replaying the uv on the
+//recorded frame is what makes the water identical.
+class InputLog
+{
+public:
+	bool startRecording(const string& path, const InputLogStart& start);
+	void stopRecording();
+	bool isRecording() const	{ return file.is_open(); }
+
+	void recordEvent(const InputEvent& event);
+	//at the start of each frame, before its drops
+	void recordFrame(float deltaTime, const RenderSettings& settings);
+	void recordDrop(const glm::vec2& uv);
+
+	//reads the whole log, start is where the camera has to be
+	bool startReplay(const string& path, InputLogStart& start);
+	void stopReplay();
+	bool isReplaying() const	{ return replaying; }
+	//false after the last frame
+	bool nextFrame(InputFrame& frame);
+	int getFrameCount() const	{ return (int)frames.size(); }
+
+private:
+	void writeSettings(const RenderSettings& settings);
+
+	ofstream file;
+	RenderSettings lastSettings;
+	bool settingsWritten = false;
+	int recordedFrames = 0;
+
+	vector<InputFrame> frames;
+	size_t replayFrame = 0;
+	bool replaying = false;
+};
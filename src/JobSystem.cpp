@@ -0,0 +1,247 @@
+#include "JobSystem.h"
+#include <cstdlib>
+#include <chrono>
+
+#include "CpuProfiler.h"
+
+struct Job
+{
+	function<void()> work;
+	JobCounter* counter;
+};
+
+bool JobSystem::started = false;
+atomic<bool> JobSystem::stopping{ false };
+vector<thread> JobSystem::threads;
+vector<JobDeque*> JobSystem::deques;
+mutex JobSystem::sleepLock;
+condition_variable JobSystem::sleeping;
+mutex JobSystem::mainThreadLock;
+vector<Job*> JobSystem::mainThreadJobs;
+
+//index of the calling thread's deque, -1 for threads that are not ours
+static thread_local int threadIndex = -1;
+
+JobDeque::JobDeque() : ring(new JobRing(256)) {}
+
+JobDeque::~JobDeque() {
+	delete ring.load(memory_order_relaxed);
+	for (JobRing* old : retired)
+		delete old;
+}
+
+void JobDeque::push(Job* job) {
+	int64_t b = bottom.load(memory_order_relaxed);
+	int64_t t = top.load(memory_order_acquire);
+	JobRing* r = ring.load(memory_order_relaxed);
+	if (b - t > r->size - 1) {
+		//full, copy into a ring twice the size. thieves may still read the old one
+		JobRing* grown = new JobRing(r->size * 2);
+		for (int64_t i = t; i < b; i++)
+			grown->put(i, r->get(i));
+		retired.push_back(r);
+		ring.store(grown, memory_order_release);
+		r = grown;
+	}
+	r->put(b, job);
+	//a thief that sees the new bottom sees the job
+	bottom.store(b + 1, memory_order_release);
+}
+
+Job* JobDeque::pop() {
+	int64_t b = bottom.load(memory_order_relaxed) - 1;
+	JobRing* r = ring.load(memory_order_relaxed);
+	bottom.store(b, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	int64_t t = top.load(memory_order_relaxed);
+	if (t > b) {
+		//empty
+		bottom.store(b + 1, memory_order_relaxed);
+		return nullptr;
+	}
+	Job* job = r->get(b);
+	if (t == b) {
+		//the last job, race the thieves for it
+		if (!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+			job = nullptr;
+		bottom.store(b + 1, memory_order_relaxed);
+	}
+	return job;
+}
+
+Job* JobDeque::steal() {
+	int64_t t = top.load(memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	int64_t b = bottom.load(memory_order_acquire);
+	if (t >= b)
+		return nullptr;
+	Job* job = ring.load(memory_order_acquire)->get(t);
+	if (!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+		return nullptr;
+	return job;
+}
+
+void JobSystem::start(int workers) {
+	if (started)
+		return;
+	if (workers <= 0)
+		workers = max((int)thread::hardware_concurrency() - 1, 1);
+
+	stopping = false;
+	threadIndex = 0;
+	for (int i = 0; i <= workers; i++)
+		deques.push_back(new JobDeque());
+	for (int i = 1; i <= workers; i++)
+		threads.push_back(thread(&JobSystem::workerLoop, i));
+	started = true;
+	atexit(&JobSystem::stop);
+	cout << "JobSystem: " << workers << " workers" << endl;
+}
+
+void JobSystem::stop() {
+	if (!started)
+		return;
+	{
+		lock_guard<mutex> lock(sleepLock);
+		stopping = true;
+	}
+	sleeping.notify_all();
+	for (thread& worker : threads)
+		worker.join();
+	threads.clear();
+	for (JobDeque* deque : deques)
+		delete deque;
+	deques.clear();
+	started = false;
+}
+
+bool JobSystem::isMainThread() {
+	return threadIndex == 0;
+}
+
+void JobSystem::run(function<void()> work, JobCounter* counter, JobCounter* after) {
+	Job* job = new Job{ move(work), counter };
+	if (counter)
+		counter->pending.fetch_add(1, memory_order_relaxed);
+
+	if (after) {
+		lock_guard<mutex> lock(after->waitingLock);
+		if (!after->isDone()) {
+			after->waiting.push_back(job);
+			return;
+		}
+	}
+	schedule(job);
+}
+
+void JobSystem::runOnMainThread(function<void()> work, JobCounter* counter) {
+	Job* job = new Job{ move(work), counter };
+	if (counter)
+		counter->pending.fetch_add(1, memory_order_relaxed);
+	lock_guard<mutex> lock(mainThreadLock);
+	mainThreadJobs.push_back(job);
+}
+
+void JobSystem::schedule(Job* job) {
+	//nothing to run it on, or a thread that owns no deque: run it right here
+	if (!started || threadIndex < 0) {
+		execute(job);
+		return;
+	}
+	deques[threadIndex]->push(job);
+	sleeping.notify_one();
+}
+
+void JobSystem::execute(Job* job) {
+	job->work();
+	JobCounter* counter = job->counter;
+	delete job;
+	if (!counter)
+		return;
+
+	//under the lock, so wait() can't return and free the counter while it is still used here
+	vector<Job*> ready;
+	{
+		lock_guard<mutex> lock(counter->waitingLock);
+		//the last job of the counter starts what waited for it
+		if (counter->pending.fetch_sub(1, memory_order_acq_rel) == 1)
+			ready.swap(counter->waiting);
+	}
+	for (Job* next : ready)
+		schedule(next);
+}
+
+Job* JobSystem::findJob(int index) {
+	Job* job = deques[index]->pop();
+	if (job)
+		return job;
+	//start stealing at a different deque on every thread
+	int count = (int)deques.size();
+	for (int i = 1; i < count; i++) {
+		job = deques[(index + i) % count]->steal();
+		if (job)
+			return job;
+	}
+	return nullptr;
+}
+
+void JobSystem::wait(JobCounter& counter) {
+	while (!counter.isDone()) {
+		if (isMainThread() || !started)
+			runMainThreadJobs();
+		Job* job = (started && threadIndex >= 0) ? findJob(threadIndex) : nullptr;
+		if (job)
+			execute(job);
+		else
+			this_thread::yield();
+	}
+	//the job that finished the counter may still hold its lock
+	lock_guard<mutex> lock(counter.waitingLock);
+}
+
+void JobSystem::parallelFor(int begin, int end, int grain, const function<void(int, int)>& body) {
+	if (end <= begin)
+		return;
+	grain = max(grain, 1);
+	JobCounter counter;
+	for (int first = begin; first < end; first += grain) {
+		int last = min(first + grain, end);
+		run([&body, first, last]() { body(first, last); }, &counter);
+	}
+	wait(counter);
+}
+
+void JobSystem::runMainThreadJobs() {
+	vector<Job*> jobs;
+	{
+		lock_guard<mutex> lock(mainThreadLock);
+		jobs.swap(mainThreadJobs);
+	}
+	for (Job* job : jobs)
+		execute(job);
+}
+
+void JobSystem::workerLoop(int index) {
+	threadIndex = index;
+	char name[32];
+	snprintf(name, sizeof(name), "worker %d", index);
+	PROFILE_THREAD(name);
+
+	int idle = 0;
+	while (!stopping.load(memory_order_relaxed)) {
+		Job* job = findJob(index);
+		if (job) {
+			execute(job);
+			idle = 0;
+			continue;
+		}
+		//spin a little, then sleep until a push wakes us (or a timeout, a push can slip past the check)
+		if (++idle < 64) {
+			this_thread::yield();
+			continue;
+		}
+		unique_lock<mutex> lock(sleepLock);
+		if (!stopping)
+			sleeping.wait_for(lock, chrono::milliseconds(1));
+	}
+}
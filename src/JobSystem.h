@@ -0,0 +1,109 @@
+#pragma once
+#include<iostream>
+#include<vector>
+#include<atomic>
+#include<mutex>
+#include<thread>
+#include<condition_variable>
+#include<functional>
+#include<cstdint>
+
+using namespace std;
+
+struct Job;
+
+//counts the jobs of a batch that have not finished yet. wait() on it, or start jobs
+//after it with JobSystem::run(..., after). reusable, and safe to destroy, once wait() returned
+struct JobCounter
+{
+	atomic<int> pending{ 0 };
+
+	bool isDone() const		{ return pending.load(memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+	mutex waitingLock;
+	vector<Job*> waiting;	//run(..., after) jobs, scheduled when pending reaches zero
+};
+
+//growable ring of the jobs of one Chase-Lev deque, old rings are kept until the deque goes
+struct JobRing
+{
+	int64_t size;
+	atomic<Job*>* jobs;
+
+	JobRing(int64_t size) : size(size), jobs(new atomic<Job*>[size]) {}
+	~JobRing() { delete[] jobs; }
+	Job* get(int64_t i) const			{ return jobs[i & (size - 1)].load(memory_order_relaxed); }
+	void put(int64_t i, Job* job)		{ jobs[i & (size - 1)].store(job, memory_order_relaxed); }
+};
+
+//Chase-Lev work stealing deque (the C11 version of Le, Pop, Cohen and Zappa Nardelli):
+//its owner pushes and pops at the bottom without locks, any thread steals from the top
+class JobDeque
+{
+public:
+	JobDeque();
+	~JobDeque();
+
+	//owner only
+	void push(Job* job);
+	Job* pop();
+	//any thread, null when empty or when another thief won
+	Job* steal();
+
+private:
+	atomic<int64_t> top{ 0 };
+	atomic<int64_t> bottom{ 0 };
+	atomic<JobRing*> ring;
+	vector<JobRing*> retired;
+};
+
+//Work stealing job system shared by the loaders and the per-frame CPU work.
+//every worker and the main thread own a JobDeque; jobs a thread starts go to its own deque,
+//idle workers steal from the others. GL calls only work on the main thread, so jobs hand
+//their GL part to runOnMainThread(); the main thread runs those while it waits and once
+//per frame (TrainView::renderFrame).
+//run() and parallelFor() are for the main thread and for jobs, not for other threads.
+class JobSystem
+{
+public:
+	//workers is the number of threads besides the main thread, 0 for one per core but one.
+	//stop() is called at exit
+	static void start(int workers = 0);
+	static void stop();
+	static bool isStarted()				{ return started; }
+	static int getWorkerCount()			{ return (int)threads.size(); }
+	static bool isMainThread();
+
+	//counter is incremented now and decremented when work has finished.
+	//with after, work only starts once after is done
+	static void run(function<void()> work, JobCounter* counter = nullptr, JobCounter* after = nullptr);
+	//work runs on the main thread, from wait() or runMainThreadJobs()
+	static void runOnMainThread(function<void()> work, JobCounter* counter = nullptr);
+	//runs other jobs until counter is done
+	static void wait(JobCounter& counter);
+
+	//body(first, last) over [begin, end) in chunks of about grain, returns when all are done
+	static void parallelFor(int begin, int end, int grain, const function<void(int, int)>& body);
+
+	//main thread only, the jobs runOnMainThread() queued so far
+	static void runMainThreadJobs();
+
+private:
+	static void workerLoop(int index);
+	static void schedule(Job* job);
+	static void execute(Job* job);
+	//a job of this thread's deque, or one stolen from another
+	static Job* findJob(int index);
+
+	static bool started;
+	static atomic<bool> stopping;
+	static vector<thread> threads;
+	static vector<JobDeque*> deques;		//[0] is the main thread's
+	static mutex sleepLock;
+	static condition_variable sleeping;
+
+	static mutex mainThreadLock;
+	static vector<Job*> mainThreadJobs;
+};
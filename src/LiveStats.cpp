@@ -0,0 +1,169 @@
+#include "LiveStats.h"
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "GpuMemory.h"
+#include "GlCallCounter.h"
+#include "FrameBuffer.h"
+
+static_assert(LIVE_STATS_GL_KINDS == GL_CALL_KIND_COUNT, "LiveStatsData::glCalls is out of date");
+static_assert(LIVE_STATS_MEMORY_CATEGORIES == GPU_MEMORY_CATEGORY_COUNT, "LiveStatsData::gpuMemoryBytes is out of date");
+
+LiveStatsBlock* LiveStats::block = nullptr;
+LiveStatsData LiveStats::data = {};
+string LiveStats::name;
+#ifdef _WIN32
+void* LiveStats::mapping = nullptr;
+#endif
+
+bool LiveStats::open(const char* name) {
+	if (block)
+		return true;
+
+#ifdef _WIN32
+	//the mapping lives as long as a handle to it, no leading slash in its name
+	string mappingName = string("Local\\") + (name[0] == '/' ? name + 1 : name);
+	mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(LiveStatsBlock), mappingName.c_str());
+	if (!mapping) {
+		cout << "LiveStats: can't create " << mappingName << endl;
+		return false;
+	}
+	void* memory = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(LiveStatsBlock));
+	if (!memory) {
+		CloseHandle(mapping);
+		mapping = nullptr;
+		cout << "LiveStats: can't map " << mappingName << endl;
+		return false;
+	}
+	int pid = (int)GetCurrentProcessId();
+#else
+	int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+	if (fd < 0) {
+		cout << "LiveStats: can't create " << name << endl;
+		return false;
+	}
+	if (ftruncate(fd, sizeof(LiveStatsBlock)) != 0) {
+		::close(fd);
+		cout << "LiveStats: can't size " << name << endl;
+		return false;
+	}
+	void* memory = mmap(nullptr, sizeof(LiveStatsBlock), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (memory == MAP_FAILED) {
+		cout << "LiveStats: can't map " << name << endl;
+		return false;
+	}
+	int pid = (int)getpid();
+#endif
+
+	LiveStats::name = name;
+	block = (LiveStatsBlock*)memory;
+	//magic last, a reader ignores the block until it is set
+	block->magic = 0;
+	block->version = LIVE_STATS_VERSION;
+	block->size = sizeof(LiveStatsBlock);
+	block->pid = pid;
+	block->sequence.store(0, memory_order_relaxed);
+	data = LiveStatsData();
+	block->data = data;
+	atomic_thread_fence(memory_order_release);
+	block->magic = LIVE_STATS_MAGIC;
+	return true;
+}
+
+void LiveStats::close() {
+	if (!block)
+		return;
+	block->magic = 0;
+#ifdef _WIN32
+	UnmapViewOfFile(block);
+	CloseHandle(mapping);
+	mapping = nullptr;
+#else
+	munmap(block, sizeof(LiveStatsBlock));
+	shm_unlink(name.c_str());
+#endif
+	block = nullptr;
+}
+
+void LiveStats::publish() {
+	uint32_t sequence = block->sequence.load(memory_order_relaxed);
+	block->sequence.store(sequence + 1, memory_order_relaxed);
+	//the odd sequence is visible before any of the data
+	atomic_thread_fence(memory_order_release);
+	memcpy(&block->data, &data, sizeof(LiveStatsData));
+	block->sequence.store(sequence + 2, memory_order_release);
+}
+
+void LiveStats::publishFrame(float frameMs, float gpuFrameMs, const PassTimings& stages,
+	int drawCount, int programChanges, int materialChanges) {
+	if (!block)
+		return;
+
+	data.frame++;
+	data.frameMs = frameMs;
+	data.averageFrameMs = data.frame == 1 ? frameMs : data.averageFrameMs + (frameMs - data.averageFrameMs) / 60.0f;
+	data.gpuFrameMs = gpuFrameMs;
+	for (int i = 0; i < STAGE_COUNT; i++)
+		data.stageMs[i] = stages.cpuMs[i];
+	int bucket = (int)frameMs;
+	data.histogram[bucket < 0 ? 0 : (bucket < LIVE_STATS_BUCKETS ? bucket : LIVE_STATS_BUCKETS - 1)]++;
+
+	data.drawCount = drawCount;
+	data.programChanges = programChanges;
+	data.materialChanges = materialChanges;
+	const GlCallStats& calls = GlCallCounter::getLastFrame();
+	for (int i = 0; i < GL_CALL_KIND_COUNT; i++)
+		data.glCalls[i] = calls.calls[i];
+
+	for (int i = 0; i < GPU_MEMORY_CATEGORY_COUNT; i++)
+		data.gpuMemoryBytes[i] = GpuMemory::getStats((GpuMemoryCategory)i).bytes;
+	data.gpuMemoryTotal = GpuMemory::getTotalBytes();
+	data.gpuMemoryPeak = GpuMemory::getPeakBytes();
+	data.cpuFramebufferBytes = FrameBuffer::getTotalCpuMemorySize();
+
+	publish();
+}
+
+void LiveStats::setGpuZones(const vector<GpuZoneResult>& zones) {
+	data.gpuZoneCount = (uint32_t)min(zones.size(), (size_t)LIVE_STATS_GPU_ZONES);
+	for (uint32_t i = 0; i < data.gpuZoneCount; i++) {
+		strncpy(data.gpuZoneNames[i], zones[i].name, LIVE_STATS_ZONE_NAME - 1);
+		data.gpuZoneNames[i][LIVE_STATS_ZONE_NAME - 1] = 0;
+		data.gpuZoneDepth[i] = zones[i].depth;
+		data.gpuZoneMs[i] = zones[i].ms;
+	}
+}
+
+void LiveStats::setCulling(uint32_t drawn, uint32_t culled) {
+	data.sceneDrawn = drawn;
+	data.sceneCulled = culled;
+}
+
+void LiveStats::setResolution(float scale, float frameMs) {
+	data.resolutionScale = scale;
+	data.resolutionFrameMs = frameMs;
+}
+
+void LiveStats::setUploadRing(uint64_t frameBytes, uint32_t overflows) {
+	data.uploadRingFrameBytes = frameBytes;
+	data.uploadRingOverflows = overflows;
+}
+
+void LiveStats::setLoadProgress(const char* stage, int done, int total) {
+	if (!block)
+		return;
+
+	strncpy(data.loadStage, stage, sizeof(data.loadStage) - 1);
+	data.loadStage[sizeof(data.loadStage) - 1] = 0;
+	data.loadDone = done;
+	data.loadTotal = total;
+	publish();
+}
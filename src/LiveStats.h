@@ -0,0 +1,44 @@
+#pragma once
+#include<iostream>
+#include<string>
+#include<vector>
+
+#include "LiveStatsBlock.h"
+#include "GpuProfiler.h"
+
+using namespace std;
+
+//Publishes a LiveStatsBlock in shared memory (POSIX shm, a named file mapping on Windows)
+//for WaterSurfaceStats and other monitors. Every call only copies into the block under
+//its seqlock, it never waits for a reader. Everything does nothing until open() succeeded.
+class LiveStats
+{
+public:
+	static bool open(const char* name = LIVE_STATS_NAME);
+	static void close();
+	static bool isOpen()	{ return block != nullptr; }
+
+	//once per frame, after it was submitted. memory and GL call counts are read here
+	static void publishFrame(float frameMs, float gpuFrameMs, const PassTimings& stages,
+		int drawCount, int programChanges, int materialChanges);
+	//GpuProfiler results (per pass), before publishFrame
+	static void setGpuZones(const vector<GpuZoneResult>& zones);
+	//DynamicResolution state of the frame, before publishFrame
+	static void setResolution(float scale, float frameMs);
+	//scene graph nodes of the frame's cull, before publishFrame
+	static void setCulling(uint32_t drawn, uint32_t culled);
+	//upload ring of the frame, before publishFrame
+	static void setUploadRing(uint64_t frameBytes, uint32_t overflows);
+	//stage is copied, done of total steps
+	static void setLoadProgress(const char* stage, int done, int total);
+
+private:
+	static void publish();
+
+	static LiveStatsBlock* block;
+	static LiveStatsData data;		//the writer's copy, block->data follows it
+	static string name;
+#ifdef _WIN32
+	static void* mapping;
+#endif
+};
@@ -0,0 +1,70 @@
+#pragma once
+#include<atomic>
+#include<cstdint>
+
+#include "PassTimings.h"
+
+//Layout of the shared memory stats block, shared by LiveStats (the writer, WaterSurface)
+//and WaterSurfaceStats (the reader). Fixed size fields only, bump LIVE_STATS_VERSION
+//on any change so an old reader refuses a new block instead of misreading it.
+
+//POSIX shm name; on Windows the mapping is "Local\watersurface_stats"
+#define LIVE_STATS_NAME "/watersurface_stats"
+#define LIVE_STATS_MAGIC 0x57535354u	//"WSST"
+#define LIVE_STATS_VERSION 5
+
+//frame time histogram: 1 ms per bucket, the last one holds every slower frame
+#define LIVE_STATS_BUCKETS 64
+//mirror GL_CALL_KIND_COUNT and GPU_MEMORY_CATEGORY_COUNT, checked in LiveStats.cpp
+#define LIVE_STATS_GL_KINDS 7
+#define LIVE_STATS_MEMORY_CATEGORIES 7
+//GPU profiler zones by slot (begin order of the frame), longer names are cut
+#define LIVE_STATS_GPU_ZONES 16
+#define LIVE_STATS_ZONE_NAME 16
+
+struct LiveStatsData
+{
+	uint64_t frame;
+	float frameMs;					//time since the previous frame
+	float averageFrameMs;			//exponential moving average, about the last 60 frames
+	float gpuFrameMs;				//GPU "frame" zone, a few frames late, 0 without timer queries
+	float stageMs[STAGE_COUNT];		//CPU time of each FrameStage
+	uint32_t gpuZoneCount;			//GPU time of each profiler zone, as late as gpuFrameMs
+	int32_t gpuZoneDepth[LIVE_STATS_GPU_ZONES];
+	char gpuZoneNames[LIVE_STATS_GPU_ZONES][LIVE_STATS_ZONE_NAME];
+	float gpuZoneMs[LIVE_STATS_GPU_ZONES];
+	float resolutionScale;			//DynamicResolution scale of the main pass, 1 when off
+	float resolutionFrameMs;		//the smoothed frame time it steers by
+	uint32_t histogram[LIVE_STATS_BUCKETS];	//frames since start
+
+	uint32_t drawCount;				//render queue, all flushes of the frame
+	uint32_t programChanges;
+	uint32_t materialChanges;
+	uint32_t sceneDrawn;			//scene graph nodes after frustum culling
+	uint32_t sceneCulled;
+	uint32_t glCalls[LIVE_STATS_GL_KINDS];	//by GlCallKind, 0 without WATERSURFACE_GL_TRACE
+
+	uint64_t gpuMemoryBytes[LIVE_STATS_MEMORY_CATEGORIES];	//by GpuMemoryCategory
+	uint64_t gpuMemoryTotal;
+	uint64_t gpuMemoryPeak;
+	uint64_t cpuFramebufferBytes;	//CPU copies of the FrameBuffers
+	uint64_t uploadRingFrameBytes;	//RingBuffer region size, grows after an overflow
+	uint32_t uploadRingOverflows;	//allocations that did not fit since the start
+
+	char loadStage[32];				//what initGL is loading, "ready" when done
+	int32_t loadDone;
+	int32_t loadTotal;
+};
+
+//Seqlock: the writer makes sequence odd, writes data, then makes it even again.
+//A reader copies data between two reads of an even, unchanged sequence and retries otherwise,
+//so the writer never waits for a reader.
+struct LiveStatsBlock
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size;					//sizeof(LiveStatsBlock)
+	int32_t pid;
+	std::atomic<uint32_t> sequence;
+	LiveStatsData data;
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+//the stages (groups of passes) of TrainView::renderFrame, in order.
+//not RenderPass: those order the packets inside the render queue
+enum FrameStage
+{
+	STAGE_SETUP = 0,	//upload buffer, readbacks, camera, UBO, light shaders
+	STAGE_CULL,			//scene graph update and frustum culling
+	STAGE_MAIN,			//mainFBO: scene, water (and its simulation), asteroids, skybox
+	STAGE_SCREEN,		//main screen post effects and the sub screen quads
+	STAGE_COUNT
+};
+
+static const char* const frameStageNames[STAGE_COUNT] = { "setup", "cull", "main", "screen" };
+
+//CPU milliseconds of each stage of the last frame.
+//with RenderSettings::finishPasses the GPU is drained after each stage,
+//so the times include its GPU work (benchmark runs only)
+struct PassTimings
+{
+	float cpuMs[STAGE_COUNT] = {};
+};
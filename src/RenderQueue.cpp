@@ -0,0 +1,136 @@
+#include "RenderQueue.h"
+#include "CpuProfiler.h"
+#include <algorithm>
+
+static const uint64_t PROGRAM_MASK = (1ull << 12) - 1;
+static const uint64_t MATERIAL_MASK = (1ull << 23) - 1;
+static const uint64_t DEPTH_MASK = (1ull << 24) - 1;
+static const uint64_t TRANSLUCENT_BIT = 1ull << 59;
+
+uint64_t RenderQueue::makeKey(unsigned int pass, bool translucent, unsigned int program, unsigned int material, float depth, float maxDepth) {
+	float d = glm::clamp(depth / maxDepth, 0.0f, 1.0f);
+	uint64_t depthBits = (uint64_t)(d * (float)DEPTH_MASK) & DEPTH_MASK;
+	uint64_t key = (uint64_t)(pass & 0xF) << 60;
+	if (translucent) {
+		key |= TRANSLUCENT_BIT;
+		key |= (DEPTH_MASK - depthBits) << 35;
+		key |= ((uint64_t)program & PROGRAM_MASK) << 23;
+		key |= (uint64_t)material & MATERIAL_MASK;
+	}
+	else {
+		key |= ((uint64_t)program & PROGRAM_MASK) << 47;
+		key |= ((uint64_t)material & MATERIAL_MASK) << 24;
+		key |= depthBits;
+	}
+	return key;
+}
+
+unsigned int RenderQueue::materialOf(uint64_t key) {
+	if (key & TRANSLUCENT_BIT)
+		return (unsigned int)(key & MATERIAL_MASK);
+	return (unsigned int)((key >> 24) & MATERIAL_MASK);
+}
+
+unsigned int RenderQueue::programOf(uint64_t key) {
+	if (key & TRANSLUCENT_BIT)
+		return (unsigned int)((key >> 23) & PROGRAM_MASK);
+	return (unsigned int)((key >> 47) & PROGRAM_MASK);
+}
+
+void RenderQueue::clear() {
+	packets.clear();
+	sortKeys.clear();
+}
+
+void RenderQueue::begin(const glm::mat4& viewProjection) {
+	clear();
+	transforms.begin(viewProjection);
+}
+
+unsigned int RenderQueue::addTransform(const glm::mat4& model) {
+	return transforms.add(model);
+}
+
+void RenderQueue::submit(const DrawPacket& packet) {
+	sortKeys.push_back(make_pair(packet.key, (unsigned int)packets.size()));
+	packets.push_back(packet);
+}
+
+void RenderQueue::submitModel(Model* model, Shader* shader, const glm::mat4& modelMatrix, const glm::vec3& eyePos, unsigned int pass, bool translucent) {
+	//all meshes of a model share its origin for depth sorting
+	float depth = glm::length(glm::vec3(modelMatrix[3]) - eyePos);
+	unsigned int transformIndex = transforms.add(modelMatrix);
+	for (unsigned int i = 0; i < model->meshes.size(); i++) {
+		Mesh& mesh = model->meshes[i];
+		unsigned int material = mesh.textures.empty() ? 0 : mesh.textures[0].id;
+
+		DrawPacket packet;
+		packet.key = makeKey(pass, translucent, shader->ID, material, depth, maxDepth);
+		packet.shader = shader;
+		packet.mesh = &mesh;
+		packet.transformIndex = transformIndex;
+		submit(packet);
+	}
+}
+
+void RenderQueue::submitCustom(Shader* shader, const glm::vec3& center, const glm::vec3& eyePos, unsigned int pass, function<void()> draw, bool translucent) {
+	DrawPacket packet;
+	packet.key = makeKey(pass, translucent, shader ? shader->ID : 0, 0, glm::length(center - eyePos), maxDepth);
+	packet.shader = shader;
+	packet.custom = draw;
+	submit(packet);
+}
+
+void RenderQueue::flush(RingBuffer& ring) {
+	PROFILE_FUNCTION();
+	drawCount = 0;
+	programChanges = 0;
+	materialChanges = 0;
+
+	transforms.upload(ring);
+
+	sort(sortKeys.begin(), sortKeys.end());
+
+	Shader* lastShader = nullptr;
+	Mesh* lastMesh = nullptr;
+	unsigned int lastMaterial = 0;
+	for (unsigned int i = 0; i < sortKeys.size(); i++) {
+		DrawPacket& packet = packets[sortKeys[i].second];
+
+		if (packet.custom) {
+			packet.custom();
+			//a custom draw may change any state, so forget what is bound
+			lastShader = nullptr;
+			lastMesh = nullptr;
+			drawCount++;
+			continue;
+		}
+
+		if (packet.shader != lastShader) {
+			packet.shader->use();
+			lastShader = packet.shader;
+			lastMesh = nullptr;
+			programChanges++;
+		}
+
+		unsigned int material = materialOf(packet.key);
+		if (!lastMesh || material != lastMaterial || !packet.mesh->sameTextures(*lastMesh)) {
+			packet.mesh->bindTextures(*packet.shader);
+			lastMaterial = material;
+			materialChanges++;
+		}
+		lastMesh = packet.mesh;
+
+		packet.shader->setInt("drawIndex", packet.transformIndex);
+		{
+			//Model::Draw lives in the vendored learnopengl header, its meshes are timed here
+			PROFILE_ZONE("Mesh::draw");
+			packet.mesh->drawGeometry();
+		}
+		drawCount++;
+	}
+
+	glBindVertexArray(0);
+	glActiveTexture(GL_TEXTURE0);
+	clear();
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include<vector>
+#include<functional>
+#include<cstdint>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <learnopengl/shader_m.h>
+#include <learnopengl/model.h>
+
+#include "TransformBuffer.h"
+
+using namespace std;
+
+//passes are executed in this order
+enum RenderPass
+{
+	PASS_SCENE = 0,			//opaque scene geometry
+	PASS_SKY = 1,			//skybox, after the scene so early-Z rejects covered sky pixels
+	PASS_TRANSLUCENT = 2,	//blended geometry, back to front
+};
+
+//one draw submitted to the queue
+//mesh packets are drawn by the queue itself, custom packets (water, skybox) draw themselves
+struct DrawPacket
+{
+	uint64_t key = 0;
+	Shader* shader = nullptr;
+	Mesh* mesh = nullptr;
+	unsigned int transformIndex = 0;	//entry in the queue's TransformBuffer
+	function<void()> custom;
+};
+
+//sort key layout (most significant first)
+//  opaque:      pass(4) | translucent(1) | program(12) | material(23) | depth(24)
+//  translucent: pass(4) | translucent(1) | inverted depth(24) | program(12) | material(23)
+//opaque draws go front to back inside each program/material group for early-Z,
+//translucent draws go strictly back to front
+class RenderQueue
+{
+public:
+	static uint64_t makeKey(unsigned int pass, bool translucent, unsigned int program, unsigned int material, float depth, float maxDepth);
+	static unsigned int materialOf(uint64_t key);
+	static unsigned int programOf(uint64_t key);
+
+	void clear();
+	//clear and start collecting transforms for a pass seen through viewProjection
+	void begin(const glm::mat4& viewProjection);
+	//for custom packets whose shader reads DrawTransforms
+	unsigned int addTransform(const glm::mat4& model);
+	void submit(const DrawPacket& packet);
+	//submit every mesh of a model as its own packet
+	void submitModel(Model* model, Shader* shader, const glm::mat4& modelMatrix, const glm::vec3& eyePos, unsigned int pass = PASS_SCENE, bool translucent = false);
+	//submit an object that binds its own state and issues its own draws
+	void submitCustom(Shader* shader, const glm::vec3& center, const glm::vec3& eyePos, unsigned int pass, function<void()> draw, bool translucent = false);
+	//upload the transforms, sort and execute every packet, then clear the queue
+	void flush(RingBuffer& ring);
+
+	//far distance used to quantize depth
+	float maxDepth = 5000.0f;
+
+	//counters of the last flush
+	int drawCount = 0;
+	int programChanges = 0;
+	int materialChanges = 0;
+
+private:
+	vector<DrawPacket> packets;
+	TransformBuffer transforms;
+	vector<pair<uint64_t, unsigned int>> sortKeys;
+};
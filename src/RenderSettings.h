@@ -0,0 +1,37 @@
+#pragma once
+#include <glad/glad.h>
+
+//everything a frame reads from the UI, copied once before the frame starts.
+//the passes only look at this, never at the FlTk widgets, so a frame can be
+//rendered without a window (headless runs fill it in themselves)
+struct RenderSettings
+{
+	//size of the final image (the window, or the offscreen target)
+	int width = 590;
+	int height = 590;
+	//seconds since the last frame, fixed for scripted runs
+	float deltaTime = 0.0f;
+
+	//camera buttons
+	bool worldCam = true;
+	bool topCam = false;
+	bool trainCam = false;
+
+	//1 directional, 2 point, 3 spot
+	int lightType = 1;
+	//1 sine wave, 2 height map, 3 interactive
+	int waveType = 1;
+	float waterAmplitude = 1.0f;
+	float waterWaveLength = 5.0f;
+	float waterSpeed = 5.0f;
+
+	//main screen post effects
+	bool pixelation = false;
+	bool offset = false;
+	bool grayscale = false;
+
+	//where the screen quads go, 0 = window back buffer
+	GLuint targetFramebuffer = 0;
+	//glFinish after every pass so PassTimings hold the GPU time too (benchmarks)
+	bool finishPasses = false;
+};
@@ -0,0 +1,236 @@
+#include "RenderThread.h"
+#include <chrono>
+#include <algorithm>
+
+#include "TrainView.H"
+#include "CpuProfiler.h"
+
+#pragma warning(push)
+#pragma warning(disable:4312)
+#pragma warning(disable:4311)
+#include <Fl/Fl.h>
+#pragma warning(pop)
+
+//room for a burst of drag events while the render thread is busy
+static const size_t COMMAND_QUEUE_SIZE = 4096;
+
+static thread_local bool renderThreadFlag = false;
+
+RenderThread::RenderThread(TrainView* view) : view(view), commands(COMMAND_QUEUE_SIZE) {
+}
+
+RenderThread::~RenderThread() {
+	stop();
+}
+
+bool RenderThread::start(const RenderSettings& firstSettings) {
+	if (running)
+		return true;
+	//present() blits in the window's context, the shared one uses the same glad pointers
+	if (!GLAD_GL_VERSION_1_0 && !gladLoadGL())
+		return false;
+	if (!context.create())
+		return false;
+
+	settings = firstSettings;
+	frameRequested = true;
+	running = true;
+	worker = thread(&RenderThread::loop, this);
+	return true;
+}
+
+void RenderThread::stop() {
+	{
+		lock_guard<mutex> lock(wakeLock);
+		running = false;
+	}
+	wake.notify_one();
+	if (worker.joinable())
+		worker.join();
+	context.destroy();
+}
+
+bool RenderThread::isRenderThread() {
+	return renderThreadFlag;
+}
+
+void RenderThread::push(RenderCommand&& command) {
+	if (command.type == RENDER_COMMAND_SETTINGS) {
+		lock_guard<mutex> lock(settingsLock);
+		pendingSettings = command.settings;
+		settingsPending = true;
+	}
+	//full only while the render thread is loading, it empties the queue before every frame
+	else if (!overflowing.load(memory_order_acquire) && commands.push(move(command))) {
+	}
+	//the next drag has the mouse position, the camera just moves further in one step
+	else if (command.type == RENDER_COMMAND_INPUT && command.input.event == FL_DRAG)
+		droppedCommands.fetch_add(1, memory_order_relaxed);
+	else {
+		lock_guard<mutex> lock(overflowLock);
+		overflow.push_back(move(command));
+		overflowing.store(true, memory_order_release);
+	}
+	requestFrame();
+}
+
+void RenderThread::requestFrame() {
+	{
+		lock_guard<mutex> lock(wakeLock);
+		frameRequested = true;
+	}
+	wake.notify_one();
+}
+
+void RenderThread::loop() {
+	PROFILE_THREAD("render");
+	renderThreadFlag = true;
+	if (!context.makeCurrent()) {
+		//draw() sees it stopped and renders on the UI thread instead
+		running = false;
+		return;
+	}
+	//the GL jobs of the loaders run on the thread that calls this
+	view->initGL();
+	ready.store(true, memory_order_release);
+
+	chrono::steady_clock::duration step = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<float>(frameSeconds));
+	chrono::steady_clock::time_point next = chrono::steady_clock::now();
+	while (true) {
+		{
+			unique_lock<mutex> lock(wakeLock);
+			wake.wait(lock, [this]() { return frameRequested || !running; });
+			frameRequested = false;
+		}
+		if (!running)
+			break;
+		//the commands that come in meanwhile go into the same frame
+		this_thread::sleep_until(next);
+		next = max(chrono::steady_clock::now(), next + step);
+
+		applyCommands();
+		renderFrame();
+	}
+	//what was queued before stop(), like the end of a recording, still needs the context
+	applyCommands();
+	context.doneCurrent();
+}
+
+void RenderThread::applyCommands() {
+	PROFILE_FUNCTION();
+	RenderCommand command;
+	while (commands.pop(command))
+		applyCommand(command);
+	//while overflowing push() leaves the queue alone, so these come after everything popped above
+	if (overflowing.load(memory_order_acquire)) {
+		vector<RenderCommand> late;
+		{
+			lock_guard<mutex> lock(overflowLock);
+			late.swap(overflow);
+			overflowing.store(false, memory_order_release);
+		}
+		for (RenderCommand& lateCommand : late)
+			applyCommand(lateCommand);
+	}
+	{
+		lock_guard<mutex> lock(settingsLock);
+		if (settingsPending)
+			settings = pendingSettings;
+		settingsPending = false;
+	}
+
+	unsigned int dropped = droppedCommands.load(memory_order_relaxed);
+	if (dropped != reportedDrops) {
+		cout << "RenderThread: " << dropped - reportedDrops << " drag events dropped, the queue was full" << endl;
+		reportedDrops = dropped;
+	}
+}
+
+void RenderThread::applyCommand(RenderCommand& command) {
+	switch (command.type) {
+	case RENDER_COMMAND_SETTINGS:
+		settings = command.settings;
+		break;
+	case RENDER_COMMAND_INPUT:
+		view->dispatchInput(command.input);
+		break;
+	case RENDER_COMMAND_CALL:
+		command.call();
+		break;
+	}
+}
+
+void RenderThread::renderFrame() {
+	PROFILE_FUNCTION();
+	if (settings.width <= 0 || settings.height <= 0)
+		return;
+
+	PresentedFrame& frame = frames.back();
+	//the UI thread may still be blitting out of it
+	if (frame.presented) {
+		glWaitSync(frame.presented, 0, GL_TIMEOUT_IGNORED);
+		glDeleteSync(frame.presented);
+		frame.presented = nullptr;
+	}
+	if (frame.rendered) {
+		glDeleteSync(frame.rendered);
+		frame.rendered = nullptr;
+	}
+
+	//window sized, color only: the passes have their own depth
+	FrameBufferDesc desc(settings.width, settings.height, GL_RGBA8, false, false);
+	if (frame.target && !(frame.target->getDesc() == desc)) {
+		//an old window size comes back rarely, free it instead of keeping one per size.
+		//the presented fence was waited for, the UI thread is done with its texture
+		view->fboPool.release(frame.target);
+		view->fboPool.trim();
+		frame.target = nullptr;
+	}
+	if (!frame.target)
+		frame.target = view->fboPool.acquire(desc);
+	if (!frame.target)
+		return;
+
+	RenderSettings frameSettings = settings;
+	frameSettings.targetFramebuffer = frame.target->getId();
+	//the frame starts by clearing what is bound, which must not be the window
+	glBindFramebuffer(GL_FRAMEBUFFER, frameSettings.targetFramebuffer);
+	bool more = view->runFrame(frameSettings);
+
+	frame.rendered = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	//another context can only wait for a fence that was flushed
+	glFlush();
+	frames.publish();
+	Fl::awake([](void* view) { ((TrainView*)view)->damage(1); }, view);
+
+	if (more)
+		requestFrame();
+}
+
+void RenderThread::present(int width, int height) {
+	PROFILE_FUNCTION();
+	//still loading, the window keeps what it has
+	if (!ready.load(memory_order_acquire))
+		return;
+
+	frames.update();
+	PresentedFrame& frame = frames.front();
+	if (!frame.target)
+		return;
+
+	glWaitSync(frame.rendered, 0, GL_TIMEOUT_IGNORED);
+	if (!readFramebuffer)
+		glGenFramebuffers(1, &readFramebuffer);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, frame.target->getColorId(), 0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glViewport(0, 0, width, height);
+	glBlitFramebuffer(0, 0, frame.target->getWidth(), frame.target->getHeight(), 0, 0, width, height,
+		GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+	if (frame.presented)
+		glDeleteSync(frame.presented);
+	frame.presented = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include<iostream>
+#include<thread>
+#include<atomic>
+#include<mutex>
+#include<condition_variable>
+#include<functional>
+#include<vector>
+
+#include <glad/glad.h>
+
+#include "SharedContext.h"
+#include "SpscQueue.h"
+#include "TripleBuffer.h"
+#include "RenderSettings.h"
+#include "InputLog.h"
+#include "FrameBuffer.h"
+
+using namespace std;
+
+class TrainView;
+
+enum RenderCommandType
+{
+	RENDER_COMMAND_SETTINGS,	//widget values, the frames from now on use them. not queued, the latest wins
+	RENDER_COMMAND_INPUT,		//a window event for TrainView::dispatchInput
+	RENDER_COMMAND_CALL,		//anything else that touches the render thread's state (track edits)
+};
+
+//one change from the UI thread, applied in order before the next frame
+struct RenderCommand
+{
+	RenderCommandType type = RENDER_COMMAND_CALL;
+	RenderSettings settings;
+	InputEvent input;
+	function<void()> call;
+};
+
+//a finished frame on its way to the window
+struct PresentedFrame
+{
+	FrameBuffer* target = nullptr;	//owned by the render thread, the color texture is shared
+	GLsync rendered = nullptr;		//render thread: target holds the frame
+	GLsync presented = nullptr;		//UI thread: the last blit out of target
+};
+
+//Renders the TrainView frames on a thread of their own, in a context shared with the window's.
+//the UI thread never touches the scene: it queues widget values, window events and edits
+//as RenderCommands, and in draw() only blits the newest finished frame to the window.
+//the render thread applies the commands before each frame, renders into an offscreen target
+//and hands it over through a TripleBuffer, fenced both ways, so neither thread waits for the other.
+class RenderThread
+{
+public:
+	RenderThread(TrainView* view);
+	~RenderThread();
+
+	//UI thread, in draw() with the window's context current. false if there is no shared context
+	bool start(const RenderSettings& settings);
+	void stop();
+	bool isRunning() const				{ return running; }
+	static bool isRenderThread();
+
+	//UI thread: queue a change, the render thread wakes for it. never waits: while the queue is
+	//full (the render thread is loading) drags are dropped and the rest goes to an overflow list
+	void push(RenderCommand&& command);
+	unsigned int getDroppedCount() const	{ return droppedCommands.load(memory_order_relaxed); }
+	//either thread: one more frame, even without a command
+	void requestFrame();
+
+	//UI thread: blit the newest finished frame to the window's back buffer
+	void present(int width, int height);
+
+	//frames are not rendered faster than this
+	float frameSeconds = 1.0f / 60.0f;
+
+private:
+	void loop();
+	void applyCommands();
+	void applyCommand(RenderCommand& command);
+	void renderFrame();
+
+	TrainView* view;
+	SharedContext context;
+	thread worker;
+	atomic<bool> running{ false };
+	atomic<bool> ready{ false };	//initGL done, present() may use the frames
+
+	SpscQueue<RenderCommand> commands;
+	//the commands after the queue filled up, in order; push() keeps to it until the render thread took it
+	mutex overflowLock;
+	vector<RenderCommand> overflow;
+	atomic<bool> overflowing{ false };
+	atomic<unsigned int> droppedCommands{ 0 };
+	unsigned int reportedDrops = 0;		//render thread
+	//the newest RENDER_COMMAND_SETTINGS
+	mutex settingsLock;
+	RenderSettings pendingSettings;
+	bool settingsPending = false;
+	mutex wakeLock;
+	condition_variable wake;
+	bool frameRequested = false;
+
+	//render thread
+	RenderSettings settings;
+	//render thread writes, UI thread presents
+	TripleBuffer<PresentedFrame> frames;
+
+	//UI thread, reads the shared texture (FBOs are per context)
+	GLuint readFramebuffer = 0;
+};
@@ -3,6 +3,9 @@
 #include <opencv2/imgcodecs.hpp>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <string>
+
+#include "../GpuMemory.h"
 
 
 class Texture2D
@@ -17,13 +20,15 @@ public:
 
 	Type type;
 
-	Texture2D(const char* path, Type texture_type = Texture2D::TEXTURE_DEFAULT):
+	Texture2D(const char* path, Type texture_type = Texture2D::TEXTURE_DEFAULT, GpuMemoryCategory category = GPU_MEMORY_TEXTURE):
+		//cv::imread(path, cv::IMREAD_COLOR).convertTo(img, CV_32FC3, 1 / 255.0f);	//unsigned char to float
+		Texture2D(cv::imread(path, cv::IMREAD_COLOR), path, texture_type, category)
+	{
+	}
+	//upload of an image decoded elsewhere (a job), label names it in GpuMemory
+	Texture2D(cv::Mat img, const std::string& label, Type texture_type = Texture2D::TEXTURE_DEFAULT, GpuMemoryCategory category = GPU_MEMORY_TEXTURE):
 		type(texture_type)
 	{
-		cv::Mat img;
-		//cv::imread(path, cv::IMREAD_COLOR).convertTo(img, CV_32FC3, 1 / 255.0f);	//unsigned char to float
-		img = cv::imread(path, cv::IMREAD_COLOR);
-
 		this->size.x = img.cols;
 		this->size.y = img.rows;
 
@@ -42,6 +47,8 @@ public:
 		else if (img.type() == CV_8UC4)
 			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, img.cols, img.rows, 0, GL_BGRA, GL_UNSIGNED_BYTE, img.data);
 		glBindTexture(GL_TEXTURE_2D, 0);
+		//the mipmaps above are generated before the upload, so there is only level 0
+		GpuMemory::track(GL_TEXTURE, this->id, category, GpuMemory::textureSize(GL_RGBA8, img.cols, img.rows), label);
 
 		img.release();
 	}
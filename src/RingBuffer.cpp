@@ -0,0 +1,157 @@
+#include "RingBuffer.h"
+#include "GpuMemory.h"
+#include <cstring>
+#include <algorithm>
+
+RingBuffer::RingBuffer(GLsizeiptr size) :
+	frameSize(size)
+{
+	for (int i = 0; i < RING_FRAMES; i++)
+		fences[i] = 0;
+
+	//these are only queried once, never on the frame path
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+	createStorage();
+}
+
+RingBuffer::~RingBuffer() {
+	for (int i = 0; i < RING_FRAMES; i++)
+		if (fences[i])
+			glDeleteSync(fences[i]);
+	deleteStorage();
+}
+
+void RingBuffer::createStorage() {
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferStorage(GL_COPY_WRITE_BUFFER, frameSize * RING_FRAMES, NULL, flags);
+	GpuMemory::track(GL_BUFFER, buffer, GPU_MEMORY_BUFFER, frameSize * RING_FRAMES, "upload ring (UBO, transforms)");
+	mapped = (char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, frameSize * RING_FRAMES, flags);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	if (!mapped)
+		cerr << "ERROR::RINGBUFFER::MAP_FAILED" << endl;
+}
+
+void RingBuffer::deleteStorage() {
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	GpuMemory::untrack(GL_BUFFER, buffer);
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+	mapped = nullptr;
+
+	for (Overflow& overflow : overflows) {
+		GpuMemory::untrack(GL_BUFFER, overflow.buffer);
+		glDeleteBuffers(1, &overflow.buffer);
+	}
+	overflows.clear();
+}
+
+//a new ring of size bytes per frame, once the GPU is done with all regions of the old one
+void RingBuffer::grow(GLsizeiptr size) {
+	for (int i = 0; i < RING_FRAMES; i++) {
+		if (!fences[i])
+			continue;
+		GLenum result = glClientWaitSync(fences[i], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		while (result == GL_TIMEOUT_EXPIRED)
+			result = glClientWaitSync(fences[i], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		glDeleteSync(fences[i]);
+		fences[i] = 0;
+	}
+	cerr << "RINGBUFFER::GROW " << frameSize << " -> " << size << " bytes per frame" << endl;
+	deleteStorage();
+	frameSize = size;
+	createStorage();
+}
+
+void RingBuffer::beginFrame() {
+	//the last frame overflowed, make room for all of it
+	if (overflowBytes > 0 && mapped)
+		grow(max(frameSize * 2, frameSize + overflowBytes));
+	overflowBytes = 0;
+	overflowsUsed = 0;
+
+	frame = (frame + 1) % RING_FRAMES;
+	head = 0;
+
+	//the GPU may still read this region from RING_FRAMES frames ago
+	if (fences[frame]) {
+		GLenum result = glClientWaitSync(fences[frame], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		while (result == GL_TIMEOUT_EXPIRED)
+			result = glClientWaitSync(fences[frame], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		glDeleteSync(fences[frame]);
+		fences[frame] = 0;
+	}
+}
+
+void RingBuffer::endFrame() {
+	if (fences[frame])
+		glDeleteSync(fences[frame]);
+	fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+RingAllocation RingBuffer::allocate(GLsizeiptr size, GLsizeiptr alignment) {
+	RingAllocation allocation;
+	GLsizeiptr start = (head + alignment - 1) / alignment * alignment;
+	if (!mapped || start + size > frameSize) {
+		//a CPU copy for now, bindRange() gives it a buffer of its own
+		if (overflowsUsed == (int)overflows.size())
+			overflows.push_back(Overflow());
+		Overflow& overflow = overflows[overflowsUsed];
+		overflow.data.resize(size);
+		allocation.ptr = overflow.data.data();
+		allocation.size = size;
+		allocation.overflow = overflowsUsed++;
+		overflowBytes += size + alignment;
+		overflowCount++;
+		return allocation;
+	}
+
+	allocation.offset = frame * frameSize + start;
+	allocation.ptr = mapped + allocation.offset;
+	allocation.size = size;
+	head = start + size;
+	return allocation;
+}
+
+RingAllocation RingBuffer::allocateUniform(GLsizeiptr size) {
+	return allocate(size, uniformAlignment);
+}
+
+RingAllocation RingBuffer::allocateStorage(GLsizeiptr size) {
+	return allocate(size, storageAlignment);
+}
+
+RingAllocation RingBuffer::allocateVertex(GLsizeiptr size) {
+	//vertex attributes only need their component alignment, 16 covers vec4/mat4
+	return allocate(size, 16);
+}
+
+RingAllocation RingBuffer::upload(const void* data, GLsizeiptr size, GLsizeiptr alignment) {
+	RingAllocation allocation = allocate(size, alignment);
+	if (allocation.ptr)
+		memcpy(allocation.ptr, data, size);
+	return allocation;
+}
+
+void RingBuffer::bindRange(GLenum target, GLuint index, const RingAllocation& allocation) {
+	if (!allocation.ptr)
+		return;
+	if (allocation.overflow < 0) {
+		glBindBufferRange(target, index, buffer, allocation.offset, allocation.size);
+		return;
+	}
+
+	Overflow& overflow = overflows[allocation.overflow];
+	if (!overflow.buffer)
+		glGenBuffers(1, &overflow.buffer);
+	//respecified every time, the driver keeps the old storage for the frames still reading it
+	glBindBuffer(target, overflow.buffer);
+	glBufferData(target, allocation.size, overflow.data.data(), GL_STREAM_DRAW);
+	GpuMemory::track(GL_BUFFER, overflow.buffer, GPU_MEMORY_BUFFER, allocation.size, "upload ring overflow");
+	glBindBufferBase(target, index, overflow.buffer);
+}
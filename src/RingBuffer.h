@@ -0,0 +1,80 @@
+#pragma once
+#include<iostream>
+#include<vector>
+
+#include <glad/glad.h>
+
+using namespace std;
+
+//number of frames the CPU may run ahead of the GPU
+#define RING_FRAMES 3
+
+//a piece of the ring buffer, valid until the end of the frame it was allocated in
+struct RingAllocation
+{
+	void* ptr = nullptr;		//persistently mapped, write only
+	GLintptr offset = 0;		//offset in RingBuffer::getId()
+	GLsizeiptr size = 0;
+	int overflow = -1;			//RingBuffer overflow slot, -1 when it is in the ring
+};
+
+//Upload buffer for per-frame data. The storage is created once with glBufferStorage
+//and stays mapped (persistent + coherent), so writes are plain memcpy's.
+//It is split into RING_FRAMES regions; each frame sub-allocates from its own region
+//and fences it at endFrame(). beginFrame() waits for that fence before the region
+//is reused, so the GPU never reads data the CPU is overwriting.
+//what doesn't fit into a frame's region goes to a CPU copy that bindRange() uploads into a
+//buffer of its own, and the next beginFrame() grows the ring so it fits from then on.
+class RingBuffer
+{
+public:
+	RingBuffer(GLsizeiptr frameSize);
+	~RingBuffer();
+
+	void beginFrame();
+	void endFrame();
+
+	//allocations aligned for the binding they are used with
+	RingAllocation allocate(GLsizeiptr size, GLsizeiptr alignment);
+	RingAllocation allocateUniform(GLsizeiptr size);
+	RingAllocation allocateStorage(GLsizeiptr size);
+	RingAllocation allocateVertex(GLsizeiptr size);
+	//allocate, copy and return in one go
+	RingAllocation upload(const void* data, GLsizeiptr size, GLsizeiptr alignment);
+
+	//bind an allocation to an indexed target (GL_UNIFORM_BUFFER, GL_SHADER_STORAGE_BUFFER)
+	void bindRange(GLenum target, GLuint index, const RingAllocation& allocation);
+
+	GLuint getId() const				{ return buffer; }
+	GLsizeiptr getFrameSize() const		{ return frameSize; }
+	GLsizeiptr getUsed() const			{ return head; }
+	//allocations that did not fit their region since the start
+	unsigned int getOverflowCount() const	{ return overflowCount; }
+	GLint getUniformAlignment() const	{ return uniformAlignment; }
+	GLint getStorageAlignment() const	{ return storageAlignment; }
+
+private:
+	void createStorage();
+	void deleteStorage();
+	void grow(GLsizeiptr size);
+
+	GLuint buffer = 0;
+	char* mapped = nullptr;
+	GLsizeiptr frameSize;
+	GLsizeiptr head = 0;		//bytes used in the current region
+	int frame = 0;				//current region
+	GLsync fences[RING_FRAMES];
+	GLint uniformAlignment = 256;
+	GLint storageAlignment = 256;
+
+	//allocations of this frame that did not fit, uploaded on their own in bindRange()
+	struct Overflow
+	{
+		vector<char> data;
+		GLuint buffer = 0;
+	};
+	vector<Overflow> overflows;
+	int overflowsUsed = 0;
+	GLsizeiptr overflowBytes = 0;	//this frame, with alignment, the ring grows by it
+	unsigned int overflowCount = 0;
+};
@@ -0,0 +1,201 @@
+#include "SceneGraph.h"
+#include <xmmintrin.h>
+
+void AABB::add(const AABB& other) {
+	min = glm::min(min, other.min);
+	max = glm::max(max, other.max);
+}
+
+AABB AABB::transformed(const glm::mat4& transform) const {
+	if (isEmpty())
+		return *this;
+
+	glm::vec3 center = (min + max) * 0.5f;
+	glm::vec3 extent = (max - min) * 0.5f;
+	glm::vec3 newCenter = glm::vec3(transform * glm::vec4(center, 1.0f));
+	glm::vec3 newExtent;
+	for (int r = 0; r < 3; r++)
+		newExtent[r] = fabsf(transform[0][r]) * extent.x + fabsf(transform[1][r]) * extent.y + fabsf(transform[2][r]) * extent.z;
+
+	AABB result;
+	result.min = newCenter - newExtent;
+	result.max = newCenter + newExtent;
+	return result;
+}
+
+void Frustum::extract(const glm::mat4& m) {
+	//Gribb/Hartmann: planes are sums/differences of the matrix rows
+	glm::vec4 row[4];
+	for (int i = 0; i < 4; i++)
+		row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+
+	glm::vec4 planes[6] = {
+		row[3] + row[0], row[3] - row[0],	//left, right
+		row[3] + row[1], row[3] - row[1],	//bottom, top
+		row[3] + row[2], row[3] - row[2],	//near, far
+	};
+
+	for (int i = 0; i < 8; i++) {
+		//the two padding planes accept everything
+		glm::vec4 p = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		if (i < 6) {
+			float length = glm::length(glm::vec3(planes[i]));
+			p = length > 0.0f ? planes[i] / length : planes[i];
+		}
+		nx[i] = p.x;
+		ny[i] = p.y;
+		nz[i] = p.z;
+		nd[i] = p.w;
+		ax[i] = fabsf(p.x);
+		ay[i] = fabsf(p.y);
+		az[i] = fabsf(p.z);
+	}
+}
+
+FrustumResult Frustum::test(const AABB& box) const {
+	glm::vec3 center = (box.min + box.max) * 0.5f;
+	glm::vec3 extent = (box.max - box.min) * 0.5f;
+
+	__m128 cx = _mm_set1_ps(center.x);
+	__m128 cy = _mm_set1_ps(center.y);
+	__m128 cz = _mm_set1_ps(center.z);
+	__m128 ex = _mm_set1_ps(extent.x);
+	__m128 ey = _mm_set1_ps(extent.y);
+	__m128 ez = _mm_set1_ps(extent.z);
+	__m128 zero = _mm_setzero_ps();
+
+	int intersecting = 0;
+	for (int i = 0; i < 8; i += 4) {
+		//signed distance of the box center and the box radius along each plane normal
+		__m128 distance = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_load_ps(nx + i), cx), _mm_mul_ps(_mm_load_ps(ny + i), cy)),
+			_mm_add_ps(_mm_mul_ps(_mm_load_ps(nz + i), cz), _mm_load_ps(nd + i)));
+		__m128 radius = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_load_ps(ax + i), ex), _mm_mul_ps(_mm_load_ps(ay + i), ey)),
+			_mm_mul_ps(_mm_load_ps(az + i), ez));
+
+		if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(distance, radius), zero)))
+			return FRUSTUM_OUTSIDE;
+		intersecting |= _mm_movemask_ps(_mm_cmplt_ps(_mm_sub_ps(distance, radius), zero));
+	}
+	return intersecting ? FRUSTUM_INTERSECT : FRUSTUM_INSIDE;
+}
+
+SceneNode::SceneNode(const string& name, Model* model) : name(name), model(model) {
+	if (model)
+		setBounds(model->boundsMin, model->boundsMax);
+}
+
+SceneNode::~SceneNode() {
+	for (unsigned int i = 0; i < children.size(); i++)
+		delete children[i];
+}
+
+SceneNode* SceneNode::addChild(SceneNode* child) {
+	child->parent = this;
+	children.push_back(child);
+	child->markDirty();
+	return child;
+}
+
+void SceneNode::setLocal(const glm::mat4& local) {
+	this->local = local;
+	markDirty();
+}
+
+void SceneNode::setBounds(const glm::vec3& min, const glm::vec3& max) {
+	if (bounds.min == min && bounds.max == max)
+		return;
+	bounds.min = min;
+	bounds.max = max;
+	markDirty();
+}
+
+void SceneNode::markDirty() {
+	dirty = true;
+	for (SceneNode* p = parent; p && !p->subtreeDirty; p = p->parent)
+		p->subtreeDirty = true;
+}
+
+SceneGraph::SceneGraph() {
+	root = new SceneNode("root");
+}
+
+SceneGraph::~SceneGraph() {
+	delete root;
+}
+
+void SceneGraph::update() {
+	updateNode(root, false);
+}
+
+void SceneGraph::updateNode(SceneNode* node, bool parentChanged) {
+	bool changed = parentChanged || node->dirty;
+	if (!changed && !node->subtreeDirty)
+		return;
+
+	if (changed) {
+		node->world = node->parent ? node->parent->world * node->local : node->local;
+		node->worldBounds = node->bounds.transformed(node->world);
+	}
+
+	node->subtreeBounds = node->worldBounds;
+	for (unsigned int i = 0; i < node->children.size(); i++) {
+		updateNode(node->children[i], changed);
+		node->subtreeBounds.add(node->children[i]->subtreeBounds);
+	}
+
+	node->dirty = false;
+	node->subtreeDirty = false;
+}
+
+void SceneGraph::cull(const glm::mat4& viewProjection) {
+	drawnCount = 0;
+	culledCount = 0;
+	testCount = 0;
+	frustum.extract(viewProjection);
+	cullNode(root, false);
+}
+
+void SceneGraph::cullNode(SceneNode* node, bool inside) {
+	if (node->subtreeBounds.isEmpty())
+		return;
+
+	if (!inside) {
+		testCount++;
+		FrustumResult result = frustum.test(node->subtreeBounds);
+		//nothing below is visible
+		if (result == FRUSTUM_OUTSIDE) {
+			hideSubtree(node);
+			return;
+		}
+		//everything below is visible, stop testing
+		inside = result == FRUSTUM_INSIDE;
+	}
+
+	if (node->isDrawable()) {
+		//a leaf's subtree bounds are its own bounds, already tested
+		bool visible = inside || node->children.empty();
+		if (!visible) {
+			testCount++;
+			visible = frustum.test(node->worldBounds) != FRUSTUM_OUTSIDE;
+		}
+		node->visible = visible;
+		if (visible)
+			drawnCount++;
+		else
+			culledCount++;
+	}
+
+	for (unsigned int i = 0; i < node->children.size(); i++)
+		cullNode(node->children[i], inside);
+}
+
+void SceneGraph::hideSubtree(SceneNode* node) {
+	if (node->isDrawable()) {
+		node->visible = false;
+		culledCount++;
+	}
+	for (unsigned int i = 0; i < node->children.size(); i++)
+		hideSubtree(node->children[i]);
+}
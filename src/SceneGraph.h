@@ -0,0 +1,113 @@
+#pragma once
+#include<iostream>
+#include<vector>
+#include<string>
+#include<cfloat>
+
+#include <glm/glm.hpp>
+#include <learnopengl/model.h>
+
+using namespace std;
+
+//axis aligned bounding box, empty until something is added
+struct AABB
+{
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+
+	bool isEmpty() const { return min.x > max.x; }
+	void add(const AABB& other);
+	//bounds of this box after transform (Arvo's method, no corner loop)
+	AABB transformed(const glm::mat4& transform) const;
+};
+
+enum FrustumResult
+{
+	FRUSTUM_OUTSIDE = 0,
+	FRUSTUM_INTERSECT = 1,
+	FRUSTUM_INSIDE = 2,
+};
+
+//six planes extracted from a view-projection matrix.
+//planes are kept structure-of-arrays (padded to 8) so test() checks four planes per SSE op
+class Frustum
+{
+public:
+	void extract(const glm::mat4& viewProjection);
+	FrustumResult test(const AABB& box) const;
+
+private:
+	alignas(16) float nx[8];
+	alignas(16) float ny[8];
+	alignas(16) float nz[8];
+	alignas(16) float nd[8];
+	//absolute value of the normals, for the projected box radius
+	alignas(16) float ax[8];
+	alignas(16) float ay[8];
+	alignas(16) float az[8];
+};
+
+//a node of the scene: local transform, cached world transform and bounds.
+//setLocal() marks the node dirty; SceneGraph::update() only walks dirty branches.
+class SceneNode
+{
+public:
+	SceneNode(const string& name, Model* model = nullptr);
+	~SceneNode();
+
+	SceneNode* addChild(SceneNode* child);
+
+	void setLocal(const glm::mat4& local);
+	const glm::mat4& getLocal() const	{ return local; }
+	const glm::mat4& getWorld() const	{ return world; }
+
+	//object space bounds of what this node draws, nodes without bounds are only groups
+	void setBounds(const glm::vec3& min, const glm::vec3& max);
+	bool isDrawable() const				{ return !bounds.isEmpty(); }
+
+	string name;
+	Model* model = nullptr;
+	SceneNode* parent = nullptr;
+	vector<SceneNode*> children;
+
+	//result of the last SceneGraph::cull
+	bool visible = true;
+
+private:
+	friend class SceneGraph;
+	void markDirty();
+
+	glm::mat4 local = glm::mat4(1.0f);
+	glm::mat4 world = glm::mat4(1.0f);
+	AABB bounds;			//object space
+	AABB worldBounds;		//this node only
+	AABB subtreeBounds;		//this node and all children, used for the hierarchical early-out
+	bool dirty = true;			//world matrix/bounds out of date
+	bool subtreeDirty = true;	//a descendant is dirty
+};
+
+class SceneGraph
+{
+public:
+	SceneGraph();
+	~SceneGraph();
+
+	//recompute world matrices and bounds of the dirty branches
+	void update();
+	//set SceneNode::visible on every drawable node and fill the counters
+	void cull(const glm::mat4& viewProjection);
+
+	SceneNode* root;
+
+	//counters of the last cull
+	int drawnCount = 0;
+	int culledCount = 0;
+	int testCount = 0;
+
+private:
+	void updateNode(SceneNode* node, bool parentChanged);
+	void cullNode(SceneNode* node, bool inside);
+	void hideSubtree(SceneNode* node);
+
+	Frustum frustum;
+};
@@ -0,0 +1,73 @@
+#include "SharedContext.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+SharedContext::~SharedContext() {
+	destroy();
+}
+
+#if defined(_WIN32)
+
+bool SharedContext::create() {
+	HDC currentDc = wglGetCurrentDC();
+	HGLRC current = wglGetCurrentContext();
+	if (!currentDc || !current) {
+		cout << "SharedContext: no current context to share with" << endl;
+		return false;
+	}
+	//same DC, so the same pixel format (and the same glad pointers) as the window's context
+	HGLRC shared = wglCreateContext(currentDc);
+	if (!shared) {
+		cout << "SharedContext: wglCreateContext failed" << endl;
+		return false;
+	}
+	//has to happen before the new context owns any object
+	if (!wglShareLists(current, shared)) {
+		cout << "SharedContext: wglShareLists failed" << endl;
+		wglDeleteContext(shared);
+		return false;
+	}
+	dc = currentDc;
+	context = shared;
+	return true;
+}
+
+void SharedContext::destroy() {
+	if (context)
+		wglDeleteContext((HGLRC)context);
+	context = nullptr;
+	dc = nullptr;
+}
+
+bool SharedContext::makeCurrent() {
+	if (!wglMakeCurrent((HDC)dc, (HGLRC)context)) {
+		cout << "SharedContext: wglMakeCurrent failed" << endl;
+		return false;
+	}
+	return true;
+}
+
+void SharedContext::doneCurrent() {
+	wglMakeCurrent(nullptr, nullptr);
+}
+
+#else
+
+bool SharedContext::create() {
+	cout << "SharedContext: no shared contexts on this platform, rendering on the UI thread" << endl;
+	return false;
+}
+
+void SharedContext::destroy() {
+}
+
+bool SharedContext::makeCurrent() {
+	return false;
+}
+
+void SharedContext::doneCurrent() {
+}
+
+#endif
@@ -0,0 +1,32 @@
+#pragma once
+#include<iostream>
+
+#include <glad/glad.h>
+
+using namespace std;
+
+//OpenGL context that shares its objects (textures, buffers, syncs) with the context
+//current on the calling thread, to be made current on another thread.
+//the platform API is picked at build time:
+//	_WIN32	WGL, wglShareLists with the window's context, drawing through its DC
+//	others	not supported, create() fails and the caller keeps to one context
+//FBOs and VAOs are not shared: each context makes its own.
+class SharedContext
+{
+public:
+	~SharedContext();
+
+	//on the thread whose context is current (the window's, in draw())
+	bool create();
+	void destroy();
+
+	//on the thread that uses the new context
+	bool makeCurrent();
+	void doneCurrent();
+
+private:
+#if defined(_WIN32)
+	void* dc = nullptr;			//HDC of the window
+	void* context = nullptr;	//HGLRC
+#endif
+};
@@ -0,0 +1,113 @@
+#include "Simulation.h"
+#include <chrono>
+#include <algorithm>
+
+#include "CpuProfiler.h"
+
+//a stall longer than this (debugger, sleep) is skipped instead of caught up
+static const double MAX_CATCH_UP_SECONDS = 0.25;
+
+static double now() {
+	return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Simulation::Simulation(int heightMapFrames, float tickRate) : heightMapFrames(heightMapFrames), tickSeconds(1.0f / tickRate) {
+}
+
+Simulation::~Simulation() {
+	stop();
+}
+
+void Simulation::start() {
+	if (running)
+		return;
+	running = true;
+	worker = thread(&Simulation::loop, this);
+}
+
+void Simulation::stop() {
+	if (!running)
+		return;
+	running = false;
+	worker.join();
+	//advance() goes on from the last tick the thread made
+	previous = current = state;
+	accumulator = 0.0f;
+}
+
+void Simulation::reset() {
+	bool restart = running;
+	stop();
+	state = SimulationState();
+	previous = current = state;
+	accumulator = 0.0f;
+	if (restart)
+		start();
+}
+
+void Simulation::tick(SimulationState& next) const {
+	next.tick++;
+	next.waterTime += tickSeconds;
+	//after the first 16 seconds the heightmap sequence plays, one image per tick
+	if (next.waterTime >= 16.0f)
+		next.heightMapFrame = (next.heightMapFrame + 1) % heightMapFrames;
+	next.rippleSteps++;
+}
+
+void Simulation::publish() {
+	state.publishedAt = now();
+	snapshots.back() = state;
+	snapshots.publish();
+}
+
+void Simulation::loop() {
+	PROFILE_THREAD("simulation");
+	chrono::steady_clock::duration step = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(tickSeconds));
+	chrono::steady_clock::time_point next = chrono::steady_clock::now();
+	while (running) {
+		{
+			PROFILE_ZONE("simulation tick");
+			tick(state);
+			publish();
+		}
+		next += step;
+		chrono::steady_clock::time_point time = chrono::steady_clock::now();
+		if (time - next > chrono::duration<double>(MAX_CATCH_UP_SECONDS))
+			next = time;
+		this_thread::sleep_until(next);
+	}
+}
+
+void Simulation::advance(float deltaTime) {
+	if (running)
+		return;
+	accumulator += deltaTime;
+	//a frame of exactly one tick must not lose it to rounding
+	while (accumulator >= tickSeconds * 0.999f) {
+		accumulator -= tickSeconds;
+		previous = state;
+		tick(state);
+	}
+	current = state;
+}
+
+SimulationState Simulation::sample() {
+	float alpha;
+	if (running) {
+		if (snapshots.update()) {
+			previous = current;
+			current = snapshots.front();
+		}
+		//one tick behind the newest snapshot, so there is always one to move towards
+		alpha = (float)((now() - current.publishedAt) / tickSeconds);
+	}
+	else
+		alpha = accumulator / tickSeconds;
+	alpha = min(max(alpha, 0.0f), 1.0f);
+
+	//only the water time is continuous, the counters are taken as they are
+	SimulationState result = current;
+	if (current.tick > previous.tick)
+		result.waterTime = previous.waterTime + (current.waterTime - previous.waterTime) * alpha;
+	return result;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include<iostream>
+#include<thread>
+#include<atomic>
+#include<cstdint>
+
+#include "TripleBuffer.h"
+
+using namespace std;
+
+//what the renderer needs of the simulation, one immutable copy per tick
+struct SimulationState
+{
+	uint64_t tick = 0;
+	float waterTime = 0.0f;			//seconds of water animation (WaterMesh::currentTime)
+	int heightMapFrame = 0;			//WaterMesh::heightMap_counter
+	uint64_t rippleSteps = 0;		//interactive ripple steps due since the start
+	double publishedAt = 0.0;		//steady clock seconds, for the interpolation
+};
+
+//Fixed timestep simulation of the water state, independent of the frame rate.
+//start() runs the ticks on their own thread at the tick rate and publishes a snapshot
+//after each through a TripleBuffer; sample() interpolates the last two snapshots one
+//tick behind, so the water moves smoothly whatever the frame rate.
+//without the thread (headless runs, replays) advance() runs the ticks of a frame's
+//delta time on the calling thread instead, which keeps those runs deterministic.
+//the ripple step itself is a GL pass, so the renderer runs rippleSteps of them.
+class Simulation
+{
+public:
+	//heightMapFrames is the length of the heightmap sequence (HEIGHTMAP_NUM)
+	Simulation(int heightMapFrames, float tickRate = 60.0f);
+	~Simulation();
+
+	void start();
+	void stop();
+	bool isRunning() const			{ return running; }
+	float getTickSeconds() const	{ return tickSeconds; }
+
+	//back to tick 0, the thread (if it runs) goes on from there
+	void reset();
+	//thread stopped only: the ticks of deltaTime, the rest carries over to the next call
+	void advance(float deltaTime);
+	//render side: the state to draw now
+	SimulationState sample();
+
+private:
+	void tick(SimulationState& next) const;
+	void publish();
+	void loop();
+
+	int heightMapFrames;
+	float tickSeconds;
+
+	//simulation side
+	SimulationState state;
+	TripleBuffer<SimulationState> snapshots;
+	thread worker;
+	atomic<bool> running{ false };
+
+	//render side
+	SimulationState previous;
+	SimulationState current;
+	float accumulator = 0.0f;		//advance() time not yet ticked
+};
@@ -1,4 +1,6 @@
 #include "SkyBox.h"
+#include "CpuProfiler.h"
+#include "GpuMemory.h"
 
 SkyBox::SkyBox() {
 	skyboxShader = new Shader("../src/shaders/sky_box.vert", "../src/shaders/sky_box.frag");
@@ -8,6 +10,7 @@ SkyBox::SkyBox() {
     glBindVertexArray(skyboxVAO);
     glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
+    GpuMemory::track(GL_BUFFER, skyboxVBO, GPU_MEMORY_BUFFER, sizeof(skyboxVertices), "sky box cube");
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 
@@ -28,17 +31,20 @@ SkyBox::SkyBox() {
 }
 
 unsigned int SkyBox::loadCubemap(vector<std::string> paths) {
+	PROFILE_FUNCTION();
     unsigned int textureID;
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
     int width, height, nrComponents;
+    size_t faceBytes = 0;
     for (unsigned int i = 0; i < paths.size(); i++)
     {
         unsigned char* data = stbi_load(paths[i].c_str(), &width, &height, &nrComponents, 0);
         if (data)
         {
             glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+            faceBytes += GpuMemory::textureSize(GL_RGB, width, height);
             stbi_image_free(data);
         }
         else
@@ -52,6 +58,7 @@ unsigned int SkyBox::loadCubemap(vector<std::string> paths) {
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    GpuMemory::track(GL_TEXTURE, textureID, GPU_MEMORY_CUBEMAP, faceBytes, paths.empty() ? "cubemap" : paths[0]);
 
     return textureID;
 }
@@ -63,6 +70,7 @@ void SkyBox::setMVP(glm::mat4 m, glm::mat4 v, glm::mat4 p) {
 }
 
 void SkyBox::draw() {
+	PROFILE_FUNCTION();
     glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
     skyboxShader->use();
     viewMatrix = glm::mat4(glm::mat3(viewMatrix)); // remove translation from the view matrix
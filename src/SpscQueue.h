@@ -0,0 +1,49 @@
+#pragma once
+#include<atomic>
+#include<vector>
+#include<cstddef>
+
+using namespace std;
+
+//Lock-free bounded queue for one producer and one consumer thread.
+//push() fails when the queue is full and pop() when it is empty, neither ever waits.
+//head and tail sit on their own cache lines, so the two threads don't bounce one line.
+template<typename T>
+class SpscQueue
+{
+public:
+	//capacity is rounded up to a power of two
+	SpscQueue(size_t capacity) {
+		size_t size = 2;
+		while (size < capacity)
+			size *= 2;
+		slots.resize(size);
+		mask = size - 1;
+	}
+
+	//producer side, value is only moved from when there was room
+	bool push(T&& value) {
+		size_t t = tail.load(memory_order_relaxed);
+		if (t - head.load(memory_order_acquire) == slots.size())
+			return false;
+		slots[t & mask] = move(value);
+		tail.store(t + 1, memory_order_release);
+		return true;
+	}
+
+	//consumer side
+	bool pop(T& value) {
+		size_t h = head.load(memory_order_relaxed);
+		if (h == tail.load(memory_order_acquire))
+			return false;
+		value = move(slots[h & mask]);
+		head.store(h + 1, memory_order_release);
+		return true;
+	}
+
+private:
+	vector<T> slots;
+	size_t mask;
+	alignas(64) atomic<size_t> head{ 0 };	//consumer only writes it
+	alignas(64) atomic<size_t> tail{ 0 };	//producer only writes it
+};
@@ -0,0 +1,252 @@
+#include "StaticBatch.h"
+#include "GpuMemory.h"
+
+StaticBatch::StaticBatch() {
+}
+
+StaticBatch::~StaticBatch() {
+	GLuint buffers[] = { vbo, ebo, drawIdBuffer, commandBuffer, paramsBuffer };
+	for (int i = 0; i < 5; i++)
+		GpuMemory::untrack(GL_BUFFER, buffers[i]);
+	glDeleteBuffers(5, buffers);
+	GLuint arrays[] = { diffuseArray, specularArray };
+	for (int i = 0; i < 2; i++)
+		GpuMemory::untrack(GL_TEXTURE, arrays[i]);
+	glDeleteTextures(2, arrays);
+	glDeleteVertexArrays(1, &vao);
+}
+
+int StaticBatch::addModel(Model* model) {
+	vector<MeshRange> ranges;
+	for (unsigned int i = 0; i < model->meshes.size(); i++) {
+		Mesh& mesh = model->meshes[i];
+
+		MeshRange range;
+		range.indexCount = (GLuint)mesh.indices.size();
+		range.firstIndex = (GLuint)indices.size();
+		range.baseVertex = (GLint)vertices.size();
+		range.materialIndex = findMaterial(mesh);
+		ranges.push_back(range);
+
+		vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+		indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+	}
+	models.push_back(ranges);
+	return (int)models.size() - 1;
+}
+
+int StaticBatch::addInstance(int modelId, const glm::mat4& transform) {
+	instanceModels.push_back(modelId);
+	transforms.push_back(transform);
+	instanceVisible.push_back(true);
+	return (int)transforms.size() - 1;
+}
+
+void StaticBatch::setTransform(int instance, const glm::mat4& transform) {
+	transforms[instance] = transform;
+}
+
+void StaticBatch::setVisible(int instance, bool visible) {
+	if (instanceVisible[instance] == visible)
+		return;
+	instanceVisible[instance] = visible;
+	commandsDirty = true;
+}
+
+//materials are identified by their first diffuse and first specular texture
+GLuint StaticBatch::findMaterial(const Mesh& mesh) {
+	MaterialKey key = { 0, 0 };
+	for (unsigned int i = 0; i < mesh.textures.size(); i++) {
+		if (!key.diffuse && mesh.textures[i].type == "texture_diffuse")
+			key.diffuse = mesh.textures[i].id;
+		else if (!key.specular && mesh.textures[i].type == "texture_specular")
+			key.specular = mesh.textures[i].id;
+	}
+
+	map<MaterialKey, GLuint>::iterator found = materialIndices.find(key);
+	if (found != materialIndices.end())
+		return found->second;
+
+	GLuint index = (GLuint)materials.size();
+	materials.push_back(key);
+	materialIndices[key] = index;
+	return index;
+}
+
+void StaticBatch::build() {
+	//geometry, same attribute layout as Mesh::setupMesh
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &vbo);
+	glGenBuffers(1, &ebo);
+	glBindVertexArray(vao);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+	GpuMemory::track(GL_BUFFER, vbo, GPU_MEMORY_MESH, vertices.size() * sizeof(Vertex), "static batch vertices");
+	GpuMemory::track(GL_BUFFER, ebo, GPU_MEMORY_MESH, indices.size() * sizeof(unsigned int), "static batch indices");
+
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+	glEnableVertexAttribArray(4);
+	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+
+	//one command per mesh per instance
+	commands.clear();
+	params.clear();
+	for (unsigned int i = 0; i < instanceModels.size(); i++) {
+		const vector<MeshRange>& ranges = models[instanceModels[i]];
+		for (unsigned int j = 0; j < ranges.size(); j++) {
+			DrawElementsIndirectCommand command;
+			command.count = ranges[j].indexCount;
+			command.instanceCount = 1;
+			command.firstIndex = ranges[j].firstIndex;
+			command.baseVertex = ranges[j].baseVertex;
+			command.baseInstance = (GLuint)commands.size();
+			commands.push_back(command);
+
+			BatchDrawParams p = { i, ranges[j].materialIndex, 0, 0 };
+			params.push_back(p);
+		}
+	}
+
+	//draw index attribute: instance divisor 1 + baseInstance gives gl_DrawID without GL 4.6
+	vector<GLuint> drawIds(commands.size());
+	for (unsigned int i = 0; i < drawIds.size(); i++)
+		drawIds[i] = i;
+	glGenBuffers(1, &drawIdBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+	glBufferData(GL_ARRAY_BUFFER, drawIds.size() * sizeof(GLuint), drawIds.data(), GL_STATIC_DRAW);
+	GpuMemory::track(GL_BUFFER, drawIdBuffer, GPU_MEMORY_BUFFER, drawIds.size() * sizeof(GLuint), "static batch draw ids");
+	glEnableVertexAttribArray(BATCH_DRAW_ID_LOCATION);
+	glVertexAttribIPointer(BATCH_DRAW_ID_LOCATION, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+	glVertexAttribDivisor(BATCH_DRAW_ID_LOCATION, 1);
+	glBindVertexArray(0);
+
+	glGenBuffers(1, &commandBuffer);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_DYNAMIC_DRAW);
+	GpuMemory::track(GL_BUFFER, commandBuffer, GPU_MEMORY_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), "static batch commands");
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	glGenBuffers(1, &paramsBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, paramsBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, params.size() * sizeof(BatchDrawParams), params.data(), GL_STATIC_DRAW);
+	GpuMemory::track(GL_BUFFER, paramsBuffer, GPU_MEMORY_BUFFER, params.size() * sizeof(BatchDrawParams), "static batch params");
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	buildMaterialArrays();
+
+	//the CPU copies are not needed anymore
+	vector<Vertex>().swap(vertices);
+	vector<unsigned int>().swap(indices);
+	built = true;
+
+	cout << "StaticBatch: " << commands.size() << " draws, " << materials.size() << " materials" << endl;
+}
+
+void StaticBatch::buildMaterialArrays() {
+	GLsizei layers = (GLsizei)glm::max<size_t>(materials.size(), 1);
+	GLsizei levels = 1;
+	for (int size = BATCH_MATERIAL_SIZE; size > 1; size >>= 1)
+		levels++;
+
+	GLuint* arrays[] = { &diffuseArray, &specularArray };
+	for (int i = 0; i < 2; i++) {
+		glGenTextures(1, arrays[i]);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, *arrays[i]);
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, GL_RGBA8, BATCH_MATERIAL_SIZE, BATCH_MATERIAL_SIZE, layers);
+		GpuMemory::track(GL_TEXTURE, *arrays[i], GPU_MEMORY_MODEL_TEXTURE,
+			GpuMemory::textureSize(GL_RGBA8, BATCH_MATERIAL_SIZE, BATCH_MATERIAL_SIZE, layers, true),
+			i == 0 ? "static batch diffuse" : "static batch specular");
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+
+	//missing maps become white diffuse / black specular
+	for (unsigned int i = 0; i < materials.size(); i++) {
+		copyToLayer(materials[i].diffuse, diffuseArray, i, glm::vec4(1.0f));
+		copyToLayer(materials[i].specular, specularArray, i, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	}
+
+	for (int i = 0; i < 2; i++) {
+		glBindTexture(GL_TEXTURE_2D_ARRAY, *arrays[i]);
+		glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+//source textures have arbitrary sizes, so resample them with a framebuffer blit
+void StaticBatch::copyToLayer(GLuint srcTexture, GLuint dstArray, GLint layer, const glm::vec4& fallback) {
+	GLuint fbos[2];
+	glGenFramebuffers(2, fbos);
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[1]);
+	glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, dstArray, 0, layer);
+
+	if (srcTexture) {
+		GLint width = 0, height = 0;
+		glBindTexture(GL_TEXTURE_2D, srcTexture);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, fbos[0]);
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, srcTexture, 0);
+		glBlitFramebuffer(0, 0, width, height, 0, 0, BATCH_MATERIAL_SIZE, BATCH_MATERIAL_SIZE, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	}
+	else {
+		glClearBufferfv(GL_COLOR, 0, &fallback[0]);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(2, fbos);
+}
+
+void StaticBatch::draw(Shader& shader, RingBuffer& ring, const glm::mat4& viewProjection) {
+	if (!built || commands.empty())
+		return;
+
+	//transforms may change every frame
+	RingAllocation transformData = ring.allocateStorage(transforms.size() * sizeof(DrawTransform));
+	if (!transformData.ptr)
+		return;
+	DrawTransform* dst = (DrawTransform*)transformData.ptr;
+	for (unsigned int i = 0; i < transforms.size(); i++)
+		dst[i] = TransformBuffer::make(transforms[i], viewProjection);
+	ring.bindRange(GL_SHADER_STORAGE_BUFFER, TRANSFORM_BINDING, transformData);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PARAMS_BINDING, paramsBuffer);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, diffuseArray);
+	glActiveTexture(GL_TEXTURE0 + 1);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, specularArray);
+	shader.setInt("diffuseMaps", 0);
+	shader.setInt("specularMaps", 1);
+
+	glBindVertexArray(vao);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	//visibility only changes when an instance crosses the frustum, so patch the commands then
+	if (commandsDirty) {
+		for (unsigned int i = 0; i < commands.size(); i++)
+			commands[i].instanceCount = instanceVisible[params[i].transformIndex] ? 1 : 0;
+		glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+		commandsDirty = false;
+	}
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)0, (GLsizei)commands.size(), 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include<iostream>
+#include<vector>
+#include<map>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <learnopengl/shader_m.h>
+#include <learnopengl/model.h>
+
+#include "RingBuffer.h"
+#include "TransformBuffer.h"
+
+using namespace std;
+
+//size of one layer in the material texture arrays
+#define BATCH_MATERIAL_SIZE 1024
+//attribute location of the per-draw index (baseInstance trick)
+#define BATCH_DRAW_ID_LOCATION 5
+
+//layout defined by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint  baseVertex;
+	GLuint baseInstance;
+};
+
+//std430 layout of DrawParams in batch_light.vert
+struct BatchDrawParams
+{
+	GLuint transformIndex;
+	GLuint materialIndex;
+	GLuint pad0;
+	GLuint pad1;
+};
+
+//Static models that share the learnopengl Vertex format, merged into one
+//vertex/index buffer and drawn with a single glMultiDrawElementsIndirect.
+//Every mesh of every instance is one indirect command; its baseInstance is the
+//draw index used to fetch the transform and material from shader storage buffers.
+//Diffuse/specular textures are resampled into two texture arrays, one layer per material.
+class StaticBatch
+{
+public:
+	StaticBatch();
+	~StaticBatch();
+
+	//register the geometry of a model once, returns its id
+	int addModel(Model* model);
+	//place a copy of a registered model, returns the instance id
+	int addInstance(int modelId, const glm::mat4& transform);
+	void setTransform(int instance, const glm::mat4& transform);
+	//hidden instances keep their commands with an instance count of 0
+	void setVisible(int instance, bool visible);
+
+	//upload geometry, materials and commands; call after all models and instances are added
+	void build();
+	//the shader has to be in use with its light uniforms set
+	//model/mvp/normal matrices are computed here and uploaded through the per-frame ring buffer
+	void draw(Shader& shader, RingBuffer& ring, const glm::mat4& viewProjection);
+
+	int getDrawCount() const { return (int)commands.size(); }
+	int getMaterialCount() const { return (int)materials.size(); }
+
+	//shader storage binding points used by batch_light.vert
+	static const GLuint TRANSFORM_BINDING = 2;
+	static const GLuint PARAMS_BINDING = 3;
+
+private:
+	struct MeshRange
+	{
+		GLuint indexCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint materialIndex;
+	};
+	struct MaterialKey
+	{
+		GLuint diffuse;
+		GLuint specular;
+		bool operator<(const MaterialKey& o) const { return diffuse < o.diffuse || (diffuse == o.diffuse && specular < o.specular); }
+	};
+
+	GLuint findMaterial(const Mesh& mesh);
+	void buildMaterialArrays();
+	void copyToLayer(GLuint srcTexture, GLuint dstArray, GLint layer, const glm::vec4& fallback);
+
+	vector<Vertex> vertices;
+	vector<unsigned int> indices;
+	vector<vector<MeshRange>> models;		//mesh ranges of each registered model
+	vector<int> instanceModels;				//model id of each instance
+	vector<glm::mat4> transforms;			//one per instance
+	vector<bool> instanceVisible;
+	bool commandsDirty = false;
+	vector<MaterialKey> materials;
+	map<MaterialKey, GLuint> materialIndices;
+
+	vector<DrawElementsIndirectCommand> commands;
+	vector<BatchDrawParams> params;
+
+	GLuint vao = 0;
+	GLuint vbo = 0;
+	GLuint ebo = 0;
+	GLuint drawIdBuffer = 0;
+	GLuint commandBuffer = 0;
+	GLuint paramsBuffer = 0;
+	GLuint diffuseArray = 0;
+	GLuint specularArray = 0;
+	bool built = false;
+};
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <cstring>
 #include <Fl/fl.h>
 
 // we will need OpenGL, and OpenGL needs windows.h
@@ -13,6 +14,10 @@
 #include "TrainView.H"
 #include "TrainWindow.H"
 #include "Utilities/3DUtils.H"
+#include "CpuProfiler.h"
+#include "GpuMemory.h"
+#include "GlCallCounter.h"
+#include "LiveStats.h"
 
 
 
@@ -28,7 +33,7 @@ TrainView(int x, int y, int w, int h, const char* l) :
 	camera = Camera(glm::vec3(0.0f, 0.0f, 3.0f));
 	camera.MovementSpeed = 200.0f;
 	camera.Position = glm::vec3(50.0, 100.0, 0.0);
-	old_t = glutGet(GLUT_ELAPSED_TIME);
+	lastFrameTime = chrono::steady_clock::now();
 	k_pressed = false;
 	
 }
@@ -40,9 +45,17 @@ resetArcball()
 	arcball.setup(this, 40, 250, .2f, .4f, 0);
 }
 
+//keys handleInput and dispatchInput act on: the camera, the toggles and the input log
+static bool isViewKey(int key)
+{
+	static const char viewKeys[] = "wsadpbrf=-gmnlctvyio";
+	return key > 0 && key < 128 && strchr(viewKeys, key) != nullptr;
+}
+
 // * FlTk Event handler for the window
 int TrainView::handle(int event)
 {
+	PROFILE_FUNCTION();
 	// see if the ArcBall will handle the event - if it does, 
 	// then we're done
 	// note: the arcball only gets the event if we're in world view
@@ -52,45 +65,115 @@ int TrainView::handle(int event)
 	}
 
 
-	// remember what button was used
-	static int last_push;
-	
-
 	switch (event) {
+		// in order to get keyboard events, we need to accept focus
+	case FL_FOCUS:
+		return 1;
+
+		// every time the mouse enters this window, aggressively take focus
+	case FL_ENTER:
+		focus(this);
+		break;
+
+	case FL_PUSH:
+	case FL_RELEASE:
+	case FL_DRAG:
+	case FL_KEYBOARD:
+	case FL_KEYUP: {
+		InputEvent input;
+		input.event = (uint8_t)event;
+		input.button = (uint8_t)Fl::event_button();
+		input.x = (int16_t)Fl::event_x();
+		input.y = (int16_t)Fl::event_y();
+		input.key = Fl::event_key();
+		input.state = Fl::event_state();
+
+		//the render thread owns the scene, the event goes there
+		if (renderThread) {
+			RenderCommand command;
+			command.type = RENDER_COMMAND_INPUT;
+			command.input = input;
+			renderThread->push(move(command));
+			//the render thread answers too late, other widgets get the keys the view has no use for
+			if (event != FL_KEYBOARD && event != FL_KEYUP)
+				return 1;
+			if (isViewKey(input.key))
+				return 1;
+			break;
+		}
+		if (dispatchInput(input))
+			return 1;
+		break;
+	}
+	}
+
+	return Fl_Gl_Window::handle(event);
+}
+
+//the event part of handle(), on the thread that owns the scene
+int TrainView::dispatchInput(const InputEvent& input)
+{
+	//the log keys are not input themselves
+	if (input.event == FL_KEYBOARD && (input.key == 'i' || input.key == 'o')) {
+		if (input.key == 'i') {
+			if (inputLog.isRecording())
+				inputLog.stopRecording();
+			else if (!inputLog.isReplaying())
+				startInputRecording("input_log.wsil");
+		}
+		else if (inputLog.isReplaying())
+			inputLog.stopReplay();
+		else if (!inputLog.isRecording())
+			startInputReplay("input_log.wsil");
+		requestRedraw();
+		return 1;
+	}
+	//the log drives the view while it replays
+	if (inputLog.isReplaying())
+		return 1;
+
+	inputLog.recordEvent(input);
+	return handleInput(input);
+}
+
+//the input part of handle(), reads nothing but input
+int TrainView::handleInput(const InputEvent& input)
+{
+	switch (input.event) {
 		// Mouse button being pushed event
 	case FL_PUSH:
-		last_push = Fl::event_button();
+		lastPush = input.button;
 		// if the left button be pushed is left mouse button
-		if (last_push == FL_LEFT_MOUSE) {
-			doPick();
-			damage(1);
+		if (lastPush == FL_LEFT_MOUSE) {
+			doPick(input.x, input.y);
+			requestRedraw();
 			return 1;
 		}
-		else if (last_push == FL_RIGHT_MOUSE) {
-			int xpos = Fl::event_x();
-			int ypos = Fl::event_y();
+		else if (lastPush == FL_RIGHT_MOUSE) {
+			int xpos = input.x;
+			int ypos = input.y;
 			lastX = xpos;
 			lastY = ypos;
-			damage(1);
+			requestRedraw();
 			return 1;
 		}
 		break;
 
 		// Mouse button release event
 	case FL_RELEASE: // button release
-		damage(1);
-		last_push = 0;
+		requestRedraw();
+		lastPush = 0;
 		return 1;
 
 		// Mouse button drag event
 	case FL_DRAG:
 
 		// Compute the new control point position
-		if ((last_push == FL_LEFT_MOUSE) && (selectedCube >= 0)) {
+		if ((lastPush == FL_LEFT_MOUSE) && (selectedCube >= 0)) {
 			ControlPoint* cp = &m_pTrack->points[selectedCube];
 
 			double r1x, r1y, r1z, r2x, r2y, r2z;
-			getMouseLine(r1x, r1y, r1z, r2x, r2y, r2z);
+			cameraState.getMouseLine(input.x, input.y, r1x, r1y, r1z, r2x, r2y, r2z);
 
 			double rx, ry, rz;
 			mousePoleGo(r1x, r1y, r1z, r2x, r2y, r2z,
@@ -98,17 +181,17 @@ int TrainView::handle(int event)
 				static_cast<double>(cp->pos.y),
 				static_cast<double>(cp->pos.z),
 				rx, ry, rz,
-				(Fl::event_state() & FL_CTRL) != 0);
+				(input.state & FL_CTRL) != 0);
 
 			cp->pos.x = (float)rx;
 			cp->pos.y = (float)ry;
 			cp->pos.z = (float)rz;
-			damage(1);
+			requestRedraw();
 		}
-		else if (last_push == FL_RIGHT_MOUSE) {
+		else if (lastPush == FL_RIGHT_MOUSE) {
 			// where is the mouse?
-			int xpos = Fl::event_x();
-			int ypos = Fl::event_y();
+			int xpos = input.x;
+			int ypos = input.y;
 			if (firstMouse)
 			{
 				lastX = xpos;
@@ -123,27 +206,18 @@ int TrainView::handle(int event)
 			lastY = ypos;
 
 			camera.ProcessMouseMovement(xoffset, yoffset);
-			damage(1);
+			requestRedraw();
 		}
 		break;
 
-		// in order to get keyboard events, we need to accept focus
-	case FL_FOCUS:
-		return 1;
-
-		// every time the mouse enters this window, aggressively take focus
-	case FL_ENTER:
-		focus(this);
-		break;
-
 	case FL_KEYBOARD:
 		if (k_pressed == false) {
 			k_pressed = true;
-			damage(1);
+			requestRedraw();
 		}
 
-		k = Fl::event_key();
-		ks = Fl::event_state();
+		k = input.key;
+		ks = input.state;
 		if (k == 'p') {
 			// Print out the selected control point information
 			if (selectedCube >= 0)
@@ -160,6 +234,72 @@ int TrainView::handle(int event)
 
 			return 1;
 		};
+		if (k == 'b') {
+			useStaticBatch = !useStaticBatch;
+			printf("Static batch %s\n", useStaticBatch ? "on" : "off");
+			requestRedraw();
+			return 1;
+		}
+		if (k == 'r') {
+			dynamicResolution->enabled = !dynamicResolution->enabled;
+			printf("Dynamic resolution %s\n", dynamicResolution->enabled ? "on" : "off");
+			requestRedraw();
+			return 1;
+		}
+		if (k == 'f') {
+			showAsteroids = !showAsteroids;
+			printf("Asteroid field %s (%u rocks)\n", showAsteroids ? "on" : "off", asteroidCount);
+			requestRedraw();
+			return 1;
+		}
+		if (k == '=' || k == '-') {
+			if (k == '=' && asteroidCount < ASTEROID_MAX_COUNT)
+				asteroidCount *= 10;
+			else if (k == '-' && asteroidCount > ASTEROID_MIN_COUNT)
+				asteroidCount /= 10;
+			printf("Asteroid count %u\n", asteroidCount);
+			requestRedraw();
+			return 1;
+		}
+		if (k == 'g') {
+			debugOverlay.visible = !debugOverlay.visible;
+			requestRedraw();
+			return 1;
+		}
+		if (k == 'm') {
+			debugOverlay.memoryVisible = !debugOverlay.memoryVisible;
+			requestRedraw();
+			return 1;
+		}
+		if (k == 'n') {
+			GpuMemory::dump("gpu_memory.txt");
+			GpuMemory::printStats();
+			return 1;
+		}
+		if (k == 'l') {
+			GlCallCounter::printLastFrame();
+			GlCallCounter::logNextFrame("gl_calls.txt");
+			requestRedraw();
+			return 1;
+		}
+		if (k == 'c') {
+			if (gpuProfiler->isWritingCsv())
+				gpuProfiler->closeCsv();
+			else
+				gpuProfiler->openCsv("gpu_profile.csv");
+			printf("GPU profile csv %s\n", gpuProfiler->isWritingCsv() ? "on" : "off");
+			return 1;
+		}
+		if (k == 't') {
+			if (!PROFILE_WRITE("cpu_trace.json"))
+				printf("CPU profiler not compiled in (WATERSURFACE_CPU_PROFILER)\n");
+			return 1;
+		}
+		if (k == 'v' || k == 'y') {
+			toggleRecording(k == 'v' ? RECORD_PNG : RECORD_Y4M);
+			requestRedraw();
+			return 1;
+		}
 		break;
 
 	case 9:
@@ -168,49 +308,245 @@ int TrainView::handle(int event)
 		break;
 	}
 
-
-	return Fl_Gl_Window::handle(event);
+	return 0;
 }
 
 // * this is the code that actually draws the window
 //   it puts a lot of the work into other routines to simplify things
 void TrainView::draw()
 {
+	PROFILE_FUNCTION();
+	//the first draw has the window's context current, the render thread shares it
+	if (renderOnThread && !renderThread) {
+		renderThread = new RenderThread(this);
+		queuedSettings = captureSettings();
+		if (!renderThread->start(queuedSettings))
+			renderOnThread = false;
+	}
+	//no shared context, or the render thread couldn't use it: render right here
+	if (renderThread && !renderThread->isRunning()) {
+		delete renderThread;
+		renderThread = nullptr;
+		renderOnThread = false;
+	}
+	if (renderThread) {
+		//a resize changes no widget, so it is queued here
+		if (w() != queuedSettings.width || h() != queuedSettings.height)
+			queueSettings();
+		renderThread->present(w(), h());
+		return;
+	}
+
+	initGL();
+	//keep drawing until the readbacks in flight come back, or the replay ends
+	if (runFrame(captureSettings()))
+		Fl::add_timeout(0.0, [](void* view) { ((TrainView*)view)->damage(1); }, this);
+}
+
+bool TrainView::runFrame(RenderSettings frameSettings)
+{
+	PROFILE_FUNCTION();
 	//calculate delta time
 	updateTimer();
 
+	//recordings and replays tick the water with the logged delta times, on this thread
+	if (simulationThread && !simulation->isRunning() && !inputLog.isReplaying() && !inputLog.isRecording())
+		simulation->start();
+
+	//the overlays go on the live window size, even when a replay renders at the recorded one
+	int width = frameSettings.width;
+	int height = frameSettings.height;
+	frameSettings.deltaTime = (float)delta_t;
+	bool replaying = inputLog.isReplaying() && replayInputFrame(frameSettings);
+	if (!replaying)
+		inputLog.recordFrame(frameSettings.deltaTime, frameSettings);
+	renderFrame(frameSettings);
+
+	const vector<GpuZoneResult>& gpuZones = gpuProfiler->getResults();
+	LiveStats::setGpuZones(gpuZones);
+	LiveStats::setResolution(dynamicResolution->getScale(), dynamicResolution->getFrameMs());
+	LiveStats::setUploadRing(dynamicBuffer->getFrameSize(), dynamicBuffer->getOverflowCount());
+	LiveStats::publishFrame((float)delta_t * 1000.0f, gpuZones.empty() ? 0.0f : gpuZones[0].ms, passTimings,
+		frameDrawCount, frameProgramChanges, frameMaterialChanges);
+
+	debugOverlay.draw(*gpuProfiler, width, height);
+	debugOverlay.drawMemory(width, height);
+
+	return asyncReadback->getPendingCount() > 0 || replaying;
+}
+
+void TrainView::queueSettings() {
+	queuedSettings = captureSettings();
+	if (!renderThread)
+		return;
+	RenderCommand command;
+	command.type = RENDER_COMMAND_SETTINGS;
+	command.settings = queuedSettings;
+	renderThread->push(move(command));
+}
+
+void TrainView::runOnRenderThread(function<void()> work) {
+	if (!renderThread) {
+		work();
+		return;
+	}
+	RenderCommand command;
+	command.type = RENDER_COMMAND_CALL;
+	command.call = move(work);
+	renderThread->push(move(command));
+}
+
+void TrainView::requestRedraw() {
+	if (renderThread && RenderThread::isRenderThread())
+		renderThread->requestFrame();
+	else
+		damage(1);
+}
+
+//camera where the log starts, water and input state back to the start
+void TrainView::resetInputState() {
+	simulation->reset();
+	firstDraw = true;
+	k_pressed = false;
+	firstMouse = true;
+	lastPush = 0;
+	replayDrops.clear();
+}
+
+bool TrainView::startInputRecording(const string& path) {
+	InputLogStart start;
+	start.position = camera.Position;
+	start.yaw = camera.Yaw;
+	start.pitch = camera.Pitch;
+	if (!inputLog.startRecording(path, start))
+		return false;
+	//the thread ticks on its own clock, which a replay can't repeat; runFrame restarts it after
+	simulation->stop();
+	resetInputState();
+	cout << "Recording input to " << path << endl;
+	return true;
+}
+
+bool TrainView::startInputReplay(const string& path) {
+	InputLogStart start;
+	if (!inputLog.startReplay(path, start))
+		return false;
+	//the replay ticks the water with the recorded delta times, runFrame restarts the thread after it
+	simulation->stop();
+	camera.Position = start.position;
+	camera.Yaw = start.yaw;
+	camera.Pitch = start.pitch;
+	camera.ProcessMouseMovement(0, 0);
+	resetInputState();
+	return true;
+}
+
+bool TrainView::replayInputFrame(RenderSettings& frameSettings) {
+	InputFrame frame;
+	if (!inputLog.nextFrame(frame)) {
+		cout << "Input replay done" << endl;
+		return false;
+	}
+	for (const InputEvent& input : frame.events)
+		handleInput(input);
+	//the runner's part stays, the widgets' part is the recorded one
+	frame.settings.targetFramebuffer = frameSettings.targetFramebuffer;
+	frame.settings.finishPasses = frameSettings.finishPasses;
+	frame.settings.deltaTime = frame.deltaTime;
+	frameSettings = frame.settings;
+	replayDrops = frame.drops;
+	return true;
+}
+
+//copy what the frame needs from the widgets
+RenderSettings TrainView::captureSettings() const {
+	RenderSettings settings;
+	settings.width = w();
+	settings.height = h();
+	settings.worldCam = tw->worldCam->value() != 0;
+	settings.topCam = tw->topCam->value() != 0;
+	settings.trainCam = tw->trainCam->value() != 0;
+	settings.lightType = tw->lightBrowser->value();
+	settings.waveType = tw->waveTypeBrowser->value();
+	settings.waterAmplitude = (float)tw->waterAmplitude->value();
+	settings.waterWaveLength = (float)tw->waterWaveLength->value();
+	settings.waterSpeed = (float)tw->waterSpeed->value();
+	settings.pixelation = tw->pixelation->value() != 0;
+	settings.offset = tw->offset->value() != 0;
+	settings.grayscale = tw->grayscale->value() != 0;
+	return settings;
+}
+
+//load glad once and create everything the passes use.
+//loader is the context's proc address function, nullptr for the FlTk window
+void TrainView::initGL(GLADloadproc loader)
+{
+	PROFILE_FUNCTION();
+	if (glLoaded)
+		return;
+
 	// * Set up basic opengl informaiton
-	//initialized glad
-	if (gladLoadGL())
+	//initialized glad, once: the render thread's context uses the window's pointers
+	if (GLAD_GL_VERSION_1_0 || (loader ? gladLoadGLLoader(loader) : gladLoadGL()))
 	{
+		glLoaded = true;
+		//counts from here on, with WATERSURFACE_GL_TRACE
+		GlCallCounter::install();
+
+		//a monitor attached now sees the loading progress
+		if (publishStats)
+			LiveStats::open();
+		//the loaders below decode on the workers, this is the thread the GL jobs run on
+		JobSystem::start();
+		simulation = new Simulation(HEIGHTMAP_NUM);
+		if (simulationThread)
+			simulation->start();
+
 		//initiailize VAO, VBO, Shader...
 		
 		//load shaders
+		LiveStats::setLoadProgress("shaders", 0, 6);
 		loadShaders();
 
 		//load models
+		LiveStats::setLoadProgress("models", 1, 6);
 		loadModels();
 
 		//load water object
+		LiveStats::setLoadProgress("water", 2, 6);
 		loadWaterMesh();
 
 		//load skyBox object
+		LiveStats::setLoadProgress("sky box", 3, 6);
 		loadSkyBox();
 
+		//place the models and the water
+		loadScene();
+
 		//initialize FBOs
+		LiveStats::setLoadProgress("framebuffers", 4, 6);
 		initFBOs();
 
 		//initialize VAOs
 		initVAOs();
 		
 		//original stuff
-		if (!this->commom_matrices)
-			this->commom_matrices = new UBO();
-			this->commom_matrices->size = 2 * sizeof(glm::mat4);
-			glGenBuffers(1, &this->commom_matrices->ubo);
-			glBindBuffer(GL_UNIFORM_BUFFER, this->commom_matrices->ubo);
-			glBufferData(GL_UNIFORM_BUFFER, this->commom_matrices->size, NULL, GL_STATIC_DRAW);
-			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		if (!this->dynamicResolution)
+			this->dynamicResolution = new DynamicResolution();
+
+		if (!this->asyncReadback)
+			this->asyncReadback = new AsyncReadback();
+
+		if (!this->gpuProfiler)
+			this->gpuProfiler = new GpuProfiler();
+
+		if (!this->frameRecorder)
+			this->frameRecorder = new FrameRecorder(*asyncReadback);
+
+		if (!this->dynamicBuffer) {
+			this->dynamicBuffer = new RingBuffer(4 * 1024 * 1024);
+			waterMesh->dynamicBuffer = this->dynamicBuffer;
+		}
 
 		if (!this->plane) {
 			GLfloat  vertices[] = {
@@ -261,14 +597,20 @@ void TrainView::draw()
 			//Element attribute
 			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->plane->ebo);
 			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(element), element, GL_STATIC_DRAW);
+			GpuMemory::track(GL_BUFFER, this->plane->vbo[0], GPU_MEMORY_BUFFER, sizeof(vertices), "plane positions");
+			GpuMemory::track(GL_BUFFER, this->plane->vbo[1], GPU_MEMORY_BUFFER, sizeof(normal), "plane normals");
+			GpuMemory::track(GL_BUFFER, this->plane->vbo[2], GPU_MEMORY_BUFFER, sizeof(texture_coordinate), "plane uvs");
+			GpuMemory::track(GL_BUFFER, this->plane->ebo, GPU_MEMORY_BUFFER, sizeof(element), "plane elements");
 
 			// Unbind VAO
 			glBindVertexArray(0);
 		}
 
+		LiveStats::setLoadProgress("textures", 5, 6);
 		loadTextures();
+		LiveStats::setLoadProgress("ready", 6, 6);
 		
-		if (!this->device){
+		if (audioEnabled && !this->device){
 			//Tutorial: https://ffainelli.github.io/openal-example/
 			this->device = alcOpenDevice(NULL);
 			if (!this->device) {
@@ -333,9 +675,41 @@ void TrainView::draw()
 	}
 	else
 		throw std::runtime_error("Could not initialize GLAD!");
+}
+
+//one frame of all passes, with the UI state of settings
+void TrainView::renderFrame(const RenderSettings& frameSettings)
+{
+	PROFILE_FUNCTION();
+	settings = frameSettings;
+	delta_t = settings.deltaTime;
+	//the water state of this frame, ticked on the simulation thread or right here
+	if (!simulation->isRunning())
+		simulation->advance(settings.deltaTime);
+	simState = simulation->sample();
+	stageStart = chrono::steady_clock::now();
+	GlCallCounter::beginFrame();
+	frameDrawCount = 0;
+	frameProgramChanges = 0;
+	frameMaterialChanges = 0;
+
+	//wait until the GPU is done with this frame's region of the upload buffer
+	dynamicBuffer->beginFrame();
+	dynamicResolution->beginFrame();
+	gpuProfiler->beginFrame();
+	int frameZone = gpuProfiler->begin("frame");
+
+	//finished readbacks (picking) run their callbacks here
+	asyncReadback->poll();
+	//a replayed frame's drops land where its recorded readbacks did
+	for (const glm::vec2& uv : replayDrops)
+		updateInteractiveHeightMapFBO(1, uv);
+	replayDrops.clear();
+	//GL work the jobs handed to the main thread
+	JobSystem::runMainThreadJobs();
 
 	// Set up the view port
-	glViewport(0,0,w(),h());
+	glViewport(0, 0, settings.width, settings.height);
 	
 
 	// clear the window, be sure to clear the Z-Buffer too
@@ -393,24 +767,37 @@ void TrainView::draw()
 	//drawStuff();
 
 	// this time drawing is for shadows (except for top view)
-	if (!tw->topCam->value()) {
+	if (!settings.topCam) {
 		setupShadows();
 		//drawStuff(true);
 		unsetupShadows();
 	}
 
 	setUBO();
-	glBindBufferRange(GL_UNIFORM_BUFFER, /*binding point*/0, this->commom_matrices->ubo, 0, this->commom_matrices->size);
 
 	//update current light_shader
 	update_light_shaders();
+	endStage(STAGE_SETUP);
 
 	//drawGround();
 
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 	glViewport(0, 0, 1920,1080);
 
-	drawMainFBO();
+	cullScene();
+	endStage(STAGE_CULL);
+
+	{
+		GpuScope zone(gpuProfiler, "main");
+		drawMainFBO();
+	}
+	endStage(STAGE_MAIN);
+
+	//the screen quads go to the window, or to the offscreen target of a headless run
+	if (settings.targetFramebuffer) {
+		glBindFramebuffer(GL_FRAMEBUFFER, settings.targetFramebuffer);
+		glViewport(0, 0, settings.width, settings.height);
+	}
 
 	//drawSubScreenFBO();
 
@@ -423,15 +810,36 @@ void TrainView::draw()
 	//drawSkyBox();
 
 	//draw main FBO to the whole screen
-	drawMainScreen();
+	{
+		GpuScope zone(gpuProfiler, "post");
+		drawMainScreen();
+	}
 
-	drawSubScreen();
+	{
+		GpuScope zone(gpuProfiler, "subscreen");
+		drawSubScreen();
+	}
+	endStage(STAGE_SCREEN);
 
 	//unbind VAO
 	glBindVertexArray(0);
 
 	//unbind shader(switch to fixed pipeline)
 	glUseProgram(0);
+
+	//the composited frame is complete in the back buffer (or the target)
+	if (settings.targetFramebuffer)
+		frameRecorder->capture(settings.targetFramebuffer, GL_COLOR_ATTACHMENT0);
+	else
+		frameRecorder->capture(0, GL_BACK);
+
+	gpuProfiler->end(frameZone);
+	gpuProfiler->endFrame();
+	dynamicResolution->endFrame(delta_t * 1000.0f);
+
+	//fence this frame's region of the upload buffer
+	dynamicBuffer->endFrame();
+	GlCallCounter::endFrame();
 }
 
 // * This sets up both the Projection and the ModelView matrices
@@ -441,15 +849,18 @@ void TrainView::
 setProjection()
 {
 	// Compute the aspect ratio (we'll need it)
-	float aspect = static_cast<float>(w()) / static_cast<float>(h());
+	float aspect = static_cast<float>(settings.width) / static_cast<float>(settings.height);
+
+	cameraState.setViewport(0, 0, settings.width, settings.height);
 
 	// Check whether we use the world camp
-	if (tw->worldCam->value()) {
+	if (settings.worldCam) {
 		//arcball.setProjection(false);
 		updata_camera();
+		cameraState.setPerspective(camera, aspect, (float)NEAR, (float)FAR);
 	}
 	// Or we use the top cam
-	else if (tw->topCam->value()) {
+	else if (settings.topCam) {
 		float wi, he;
 		if (aspect >= 1) {
 			wi = 110;
@@ -462,11 +873,7 @@ setProjection()
 		
 		// Set up the top camera drop mode to be orthogonal and set
 		// up proper projection matrix
-		glMatrixMode(GL_PROJECTION);
-		glOrtho(-wi, wi, -he, he, 200, -200);
-		glMatrixMode(GL_MODELVIEW);
-		glLoadIdentity();
-		glRotatef(-90,1,0,0);
+		cameraState.setTopOrtho(wi, he, 200, -200);
 	} 
 	// Or do the train view or other view here
 	//####################################################################
@@ -474,8 +881,12 @@ setProjection()
 	// put code for train view projection here!	
 	//####################################################################
 	else {
-
+		//no train camera yet, keep looking through the world camera
+		cameraState.setPerspective(camera, aspect, (float)NEAR, (float)FAR);
 	}
+
+	//the fixed function code (floor, shadows) still draws with the GL stack
+	cameraState.loadFixedFunction();
 }
 
 //	NOTE: if you're drawing shadows, DO NOT set colors (otherwise, you get 
@@ -486,7 +897,7 @@ void TrainView::drawStuff(bool doingShadows)
 	// Draw the control points
 	// don't draw the control points if you're driving 
 	// (otherwise you get sea-sick as you drive through them)
-	if (!tw->trainCam->value()) {
+	if (!settings.trainCam) {
 		for(size_t i=0; i<m_pTrack->points.size(); ++i) {
 			if (!doingShadows) {
 				if ( ((int) i) != selectedCube)
@@ -519,9 +930,13 @@ void TrainView::drawStuff(bool doingShadows)
 //		if you want to pick things other than control points, or you
 //		changed how control points are drawn, you might need to change this
 void TrainView::
-doPick()
+doPick(int mouseX, int mouseY)
 //========================================================================
 {
+	//a replay takes the drops the recording picked from the log
+	if (inputLog.isReplaying())
+		return;
+
 	//// since we'll need to do some GL stuff so we make this window as 
 	//// active window
 	//make_current();		
@@ -571,63 +986,65 @@ doPick()
 	//printf("Selected Cube %d\n",selectedCube);
 
 	drawColorUVFBO();
-	colorUVFBO->bind();
-	glReadBuffer(GL_COLOR_ATTACHMENT0);
-	glm::vec3 uv;
-	glReadPixels(Fl::event_x(), h() - Fl::event_y(), 1, 1, GL_RGB, GL_FLOAT, &uv[0]);
-
-	glReadBuffer(GL_NONE);
-	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
-	colorUVFBO->unbind();
-	if (uv.b != 1.0) {
-		cout << "uv.r = " << uv.r << " uv.g = " << uv.g << endl;
-		updateInteractiveHeightMapFBO(1, glm::vec2(uv.r, uv.g));
-	}
+	//the uv under the mouse arrives a frame or two later in draw(), no pipeline stall
+	asyncReadback->requestColor(*colorUVFBO, mouseX, settings.height - mouseY, 1, 1, GL_RGB, GL_FLOAT,
+		[this](const ReadbackResult& result) {
+			glm::vec3 uv = *(const glm::vec3*)result.data;
+			if (uv.b != 1.0) {
+				inputLog.recordDrop(glm::vec2(uv.r, uv.g));
+				updateInteractiveHeightMapFBO(1, glm::vec2(uv.r, uv.g));
+			}
+		});
 }
 
 void TrainView::setUBO()
 {
-	float wdt = this->pixel_w();
-	float hgt = this->pixel_h();
-
-	glm::mat4 view_matrix;
-	glGetFloatv(GL_MODELVIEW_MATRIX, &view_matrix[0][0]);
-	//HMatrix view_matrix; 
-	//this->arcball.getMatrix(view_matrix);
-
-	glm::mat4 projection_matrix;
-	glGetFloatv(GL_PROJECTION_MATRIX, &projection_matrix[0][0]);
-	//projection_matrix = glm::perspective(glm::radians(this->arcball.getFoV()), (GLfloat)wdt / (GLfloat)hgt, 0.01f, 1000.0f);
-
-	glBindBuffer(GL_UNIFORM_BUFFER, this->commom_matrices->ubo);
-	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), &projection_matrix[0][0]);
-	glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), &view_matrix[0][0]);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glm::mat4 view_matrix = cameraState.view;
+	glm::mat4 projection_matrix = cameraState.projection;
+
+	//projection then view, written straight into the mapped ring buffer
+	RingAllocation matrices = dynamicBuffer->allocateUniform(2 * sizeof(glm::mat4));
+	if (matrices.ptr) {
+		glm::mat4* dst = (glm::mat4*)matrices.ptr;
+		dst[0] = projection_matrix;
+		dst[1] = view_matrix;
+	}
+	dynamicBuffer->bindRange(GL_UNIFORM_BUFFER, /*binding point*/0, matrices);
 }
 
 void TrainView::updateTimer() {
-	now_t = glutGet(GLUT_ELAPSED_TIME);
-	delta_t = (now_t - old_t) / 1000.0;
-	old_t = now_t;
+	//glutGet(GLUT_ELAPSED_TIME) only has milliseconds
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	delta_t = chrono::duration<float>(now - lastFrameTime).count();
+	lastFrameTime = now;
+}
+
+//time since the end of the last stage
+void TrainView::endStage(FrameStage stage) {
+	if (settings.finishPasses)
+		glFinish();
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	passTimings.cpuMs[stage] = chrono::duration<float, milli>(now - stageStart).count();
+	stageStart = now;
 }
 
 void TrainView::updata_camera() {
 	if (k_pressed) {
 		if (k == 'w') {
 			camera.ProcessKeyboard(FORWARD, delta_t);
-			damage(1);
+			requestRedraw();
 		}
 		if (k == 's') {
 			camera.ProcessKeyboard(BACKWARD, delta_t);
-			damage(1);
+			requestRedraw();
 		}
 		if (k == 'a') {
 			camera.ProcessKeyboard(LEFT, delta_t);
-			damage(1);
+			requestRedraw();
 		}
 		if (k == 'd') {
 			camera.ProcessKeyboard(RIGHT, delta_t);
-			damage(1);
+			requestRedraw();
 		}
 	}
 	
@@ -635,162 +1052,198 @@ void TrainView::updata_camera() {
 }
 
 void TrainView::update_light_shaders() {
+	int lightType = settings.lightType;
+
 	//set the selected lighting shader
-	if (tw->lightBrowser->value() == 1) {
+	if (lightType == 1) {
 		current_light_shader = directional_light_shader;
 	}
-	else if (tw->lightBrowser->value() == 2) {
+	else if (lightType == 2) {
 		current_light_shader = point_light_shader;
 	}
-	else if (tw->lightBrowser->value() == 3) {
+	else if (lightType == 3) {
 		current_light_shader = spot_light_shader;
 	}
 
-	glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, (float)NEAR, (float)FAR);
-	glm::mat4 view = camera.GetViewMatrix();
-	glm::mat4 model = glm::mat4(1.0f);
+	setLightUniforms(current_light_shader, lightType);
+
+	if (showAsteroids) {
+		if (lightType == 1)
+			current_instanced_shader = directional_instanced_shader;
+		else if (lightType == 2)
+			current_instanced_shader = point_instanced_shader;
+		else if (lightType == 3)
+			current_instanced_shader = spot_instanced_shader;
+		setLightUniforms(current_instanced_shader, lightType);
+	}
+
+	//the batch shader handles every light type itself
+	if (useStaticBatch) {
+		batch_shader->use();
+		batch_shader->setInt("lightType", lightType);
+		setLightUniforms(batch_shader, lightType);
+	}
+}
 
+//model/view/projection come from the render queue's DrawTransforms buffer
+void TrainView::setLightUniforms(Shader* shader, int lightType) {
 	//directional light
-	if (tw->lightBrowser->value() == 1) {
-		directional_light_shader->use();
-		directional_light_shader->setVec3("light.direction", -1.0f, -0.1f, -0.3f);
-		directional_light_shader->setVec3("viewPos", camera.Position);
+	if (lightType == 1) {
+		shader->use();
+		shader->setVec3("light.direction", -1.0f, -0.1f, -0.3f);
+		shader->setVec3("viewPos", cameraState.position);
 		// light properties
-		directional_light_shader->setVec3("light.ambient", 0.1f, 0.1f, 0.1f);
-		directional_light_shader->setVec3("light.diffuse", 0.8f, 0.8f, 0.8f);
-		directional_light_shader->setVec3("light.specular", 1.0f, 1.0f, 1.0f);
+		shader->setVec3("light.ambient", 0.1f, 0.1f, 0.1f);
+		shader->setVec3("light.diffuse", 0.8f, 0.8f, 0.8f);
+		shader->setVec3("light.specular", 1.0f, 1.0f, 1.0f);
 		// material properties
-		directional_light_shader->setFloat("material.shininess", 32.0f);
-		// view/projection transformations
-		projection = glm::perspective(glm::radians(camera.Zoom), (float)w() / (float)h(), (float)NEAR, (float)FAR);
-		view = camera.GetViewMatrix();
-		directional_light_shader->setMat4("projection", projection);
-		directional_light_shader->setMat4("view", view);
-		// world transformation
-		//model = glm::mat4(1.0f);
-		//model = glm::scale(model, glm::vec3(5.0, 5.0, 5.0));
-		//directional_light_shader->setMat4("model", model);
+		shader->setFloat("material.shininess", 32.0f);
 	}
 
 	//point light
-	if (tw->lightBrowser->value() == 2) {
-		point_light_shader->use();
+	if (lightType == 2) {
+		shader->use();
 		glm::vec3 lightPos(35.0f, 100.0f, 2.0f);
-		point_light_shader->setVec3("light.position", lightPos);
-		point_light_shader->setVec3("viewPos", camera.Position);
+		shader->setVec3("light.position", lightPos);
+		shader->setVec3("viewPos", cameraState.position);
 
 		// light properties
-		point_light_shader->setVec3("light.ambient", 0.2f, 0.2f, 0.2f);
-		point_light_shader->setVec3("light.diffuse", 0.9f, 0.9f, 0.9f);
-		point_light_shader->setVec3("light.specular", 1.0f, 1.0f, 1.0f);
-		point_light_shader->setFloat("light.constant", 1.0f);
-		point_light_shader->setFloat("light.linear", 0.001f);
-		point_light_shader->setFloat("light.quadratic", 0.001f);
+		shader->setVec3("light.ambient", 0.2f, 0.2f, 0.2f);
+		shader->setVec3("light.diffuse", 0.9f, 0.9f, 0.9f);
+		shader->setVec3("light.specular", 1.0f, 1.0f, 1.0f);
+		shader->setFloat("light.constant", 1.0f);
+		shader->setFloat("light.linear", 0.001f);
+		shader->setFloat("light.quadratic", 0.001f);
 
 		// material properties
-		point_light_shader->setFloat("material.shininess", 32.0f);
-
-		// view/projection transformations
-		projection = glm::perspective(glm::radians(camera.Zoom), (float)w() / (float)h(), (float)NEAR, (float)FAR);
-		view = camera.GetViewMatrix();
-		point_light_shader->setMat4("projection", projection);
-		point_light_shader->setMat4("view", view);
-
-		// world transformation
-		//model = glm::mat4(1.0f);
-		//model = glm::scale(model, glm::vec3(5.0, 5.0, 5.0));
-		//point_light_shader->setMat4("model", model);
+		shader->setFloat("material.shininess", 32.0f);
 	}
 
 	//spot light
-	if (tw->lightBrowser->value() == 3) {
-		spot_light_shader->use();
-		spot_light_shader->setVec3("light.position", camera.Position);
-		spot_light_shader->setVec3("light.direction", camera.Front);
-		spot_light_shader->setFloat("light.cutOff", glm::cos(glm::radians(12.5f)));
-		spot_light_shader->setVec3("viewPos", camera.Position);
+	if (lightType == 3) {
+		shader->use();
+		shader->setVec3("light.position", cameraState.position);
+		shader->setVec3("light.direction", cameraState.front);
+		shader->setFloat("light.cutOff", glm::cos(glm::radians(12.5f)));
+		shader->setVec3("viewPos", cameraState.position);
 		// light properties
-		spot_light_shader->setVec3("light.ambient", 0.1f, 0.1f, 0.1f);
+		shader->setVec3("light.ambient", 0.1f, 0.1f, 0.1f);
 		// we configure the diffuse intensity slightly higher; the right lighting conditions differ with each lighting method and environment.
 		// each environment and lighting type requires some tweaking to get the best out of your environment.
-		spot_light_shader->setVec3("light.diffuse", 0.8f, 0.8f, 0.8f);
-		spot_light_shader->setVec3("light.specular", 1.0f, 1.0f, 1.0f);
-		spot_light_shader->setFloat("light.constant", 1.0f);
-		spot_light_shader->setFloat("light.linear", 0.05f);
-		spot_light_shader->setFloat("light.quadratic", 0.01f);
+		shader->setVec3("light.diffuse", 0.8f, 0.8f, 0.8f);
+		shader->setVec3("light.specular", 1.0f, 1.0f, 1.0f);
+		shader->setFloat("light.constant", 1.0f);
+		shader->setFloat("light.linear", 0.05f);
+		shader->setFloat("light.quadratic", 0.01f);
 		// material properties
-		spot_light_shader->setFloat("material.shininess", 32.0f);
-		// view/projection transformations
-		projection = glm::perspective(glm::radians(camera.Zoom), (float)w() / (float)h(), (float)NEAR, (float)FAR);
-		view = camera.GetViewMatrix();
-		spot_light_shader->setMat4("projection", projection);
-		spot_light_shader->setMat4("view", view);
-		// world transformation
-		//model = glm::mat4(1.0f);
-		//model = glm::scale(model, glm::vec3(5.0, 5.0, 5.0));
-		//spot_light_shader->setMat4("model", model);
+		shader->setFloat("material.shininess", 32.0f);
 	}
 }
 
 void TrainView::drawGround() {
-	//bind ground texture
-	ground_texture->bind(0);
+	PROFILE_FUNCTION();
 	// world transformation
 	glm::mat4 model = glm::mat4(1.0f);
 	model = glm::scale(model, glm::vec3(500.0, 1.0, 500.0));
-	current_light_shader->setMat4("model", model);
-
-	//bind VAO and draw plane
-	glBindVertexArray(this->plane->vao);
-	glDrawElements(GL_TRIANGLES, this->plane->element_amount, GL_UNSIGNED_INT, 0);
-	ground_texture->unbind(0);
+	unsigned int transformIndex = renderQueue.addTransform(model);
+
+	Shader* shader = current_light_shader;
+	Texture2D* texture = ground_texture;
+	VAO* ground = plane;
+	renderQueue.submitCustom(shader, glm::vec3(0.0f), cameraState.position, PASS_SCENE,
+		[shader, texture, ground, transformIndex]() {
+			shader->use();
+			shader->setInt("drawIndex", transformIndex);
+			//bind ground texture
+			texture->bind(0);
+			//bind VAO and draw plane
+			glBindVertexArray(ground->vao);
+			glDrawElements(GL_TRIANGLES, ground->element_amount, GL_UNSIGNED_INT, 0);
+			texture->unbind(0);
+		});
 }
 
-void TrainView::drawTrain() {
-	
+glm::mat4 TrainView::trainModelMatrix() {
 	// world transformation
 	glm::mat4 model = glm::mat4(1.0f);
 	model = glm::translate(model, glm::vec3(0, 100, 0));
 	model = glm::scale(model, glm::vec3(10, 10, 10));
-	current_light_shader->setMat4("model", model);
-
-	sci_fi_train->Draw(*current_light_shader);
+	return model;
 }
 
-void TrainView::drawTeapot() {
-
+glm::mat4 TrainView::teapotModelMatrix() {
 	// world transformation
 	glm::mat4 model = glm::mat4(1.0f);
 	model = glm::translate(model, glm::vec3(100, 100, 0));
 	model = glm::scale(model, glm::vec3(10, 10, 10));
-	current_light_shader->setMat4("model", model);
+	return model;
+}
 
-	teapot->Draw(*current_light_shader);
+void TrainView::drawTrain() {
+	PROFILE_FUNCTION();
+	if (trainNode->visible)
+		renderQueue.submitModel(sci_fi_train, current_light_shader, trainNode->getWorld(), cameraState.position);
 }
 
-void TrainView::drawWater(int mode) {
-	glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, (float)NEAR, (float)FAR);
-	glm::mat4 view = camera.GetViewMatrix();
-	glm::mat4 model = glm::mat4(1.0);
-	model = glm::translate(model, glm::vec3(0, 10, 0));
-	model = glm::scale(model, glm::vec3(10,1,10));
+void TrainView::drawTeapot() {
+	PROFILE_FUNCTION();
+	if (teapotNode->visible)
+		renderQueue.submitModel(teapot, current_light_shader, teapotNode->getWorld(), cameraState.position);
+}
+
+//every static model in one glMultiDrawElementsIndirect
+void TrainView::drawStaticBatch() {
+	PROFILE_FUNCTION();
+	if (!trainNode->visible && !teapotNode->visible)
+		return;
+
+	staticBatch->setTransform(0, trainNode->getWorld());
+	staticBatch->setTransform(1, teapotNode->getWorld());
+	staticBatch->setVisible(0, trainNode->visible);
+	staticBatch->setVisible(1, teapotNode->visible);
+
+	StaticBatch* batch = staticBatch;
+	Shader* shader = batch_shader;
+	RingBuffer* ring = dynamicBuffer;
+	glm::mat4 viewProjection = cameraState.viewProjection;
+	renderQueue.submitCustom(batch_shader, cameraState.position, cameraState.position, PASS_SCENE,
+		[batch, shader, ring, viewProjection]() {
+			shader->use();
+			batch->draw(*shader, *ring, viewProjection);
+		});
+}
 
-	waterMesh->setEyePos(camera.Position);
+//ripple passes one frame may run to catch up with the simulation
+#define MAX_RIPPLE_STEPS_PER_FRAME 4
+
+//advance the water and run the passes it depends on, without drawing it
+void TrainView::updateWater(int mode) {
+	glm::mat4 projection = cameraState.projection;
+	glm::mat4 view = cameraState.view;
+	glm::mat4 model = waterNode->getWorld();
+
+	waterMesh->setEyePos(cameraState.position);
 	waterMesh->setMVP(model, view, projection);
-	waterMesh->addTime(delta_t);
+	waterMesh->currentTime = simState.waterTime;
+	waterMesh->heightMap_counter = simState.heightMapFrame;
 
-	waterMesh->amplitude_coefficient = tw->waterAmplitude->value();
-	waterMesh->waveLength_coefficient = tw->waterWaveLength->value();
-	waterMesh->speed_coefficient = tw->waterSpeed->value();
+	waterMesh->amplitude_coefficient = settings.waterAmplitude;
+	waterMesh->waveLength_coefficient = settings.waterWaveLength;
+	waterMesh->speed_coefficient = settings.waterSpeed;
 
 	if (mode == 3) {
 		if (firstDraw) {
 			updateInteractiveHeightMapFBO(0);
 			updateInteractiveHeightMapFBO(0);
 			firstDraw = false;
+			rippleStepsDone = simState.rippleSteps;
 		}
 		else {
-			updateInteractiveHeightMapFBO(2);
+			//the ripples move at the tick rate; after a long frame only the last few steps run
+			uint64_t steps = min(simState.rippleSteps - rippleStepsDone, (uint64_t)MAX_RIPPLE_STEPS_PER_FRAME);
+			for (uint64_t i = 0; i < steps; i++)
+				updateInteractiveHeightMapFBO(2);
+			rippleStepsDone = simState.rippleSteps;
 		}
 		
 		
@@ -800,22 +1253,58 @@ void TrainView::drawWater(int mode) {
 		else {
 			waterMesh->interactiveTexId = interactiveHeightMapFBO1->getColorId();
 		}
-		mainFBO->bind();
+		bindMainFBO();
 	}
+}
 
+void TrainView::drawWater(int mode) {
+	updateWater(mode);
 	waterMesh->draw(mode);
 }
 
+//update the water now, draw it when the render queue is flushed
+void TrainView::submitWater(int mode) {
+	PROFILE_FUNCTION();
+	updateWater(mode);
+	if (!waterNode->visible)
+		return;
+
+	Shader* shader = waterMesh->color_uv_shader;
+	if (mode == 1)
+		shader = waterMesh->sinWave_shader;
+	else if (mode == 2 || mode == 3)
+		shader = waterMesh->heightMap_shader;
+
+	//the sine wave and height map shaders read their matrices from the queue's transforms
+	waterMesh->drawIndex = renderQueue.addTransform(waterMesh->modelMatrix);
+
+	WaterMesh* water = waterMesh;
+	GpuProfiler* profiler = gpuProfiler;
+	renderQueue.submitCustom(shader, glm::vec3(waterMesh->modelMatrix[3]), cameraState.position, PASS_SCENE,
+		[water, mode, profiler]() {
+			GpuScope zone(profiler, "water");
+			water->draw(mode);
+		});
+}
+
 void TrainView::drawSkyBox() {
-	glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, (float)NEAR, (float)FAR);
-	glm::mat4 view = camera.GetViewMatrix();
+	PROFILE_FUNCTION();
+	glm::mat4 projection = cameraState.projection;
+	glm::mat4 view = cameraState.view;
 	glm::mat4 model = glm::mat4(1.0);
 
 	skyBox->setMVP(model, view, projection);
-	skyBox->draw();
+	SkyBox* sky = skyBox;
+	GpuProfiler* profiler = gpuProfiler;
+	renderQueue.submitCustom(skyBox->skyboxShader, cameraState.position, cameraState.position, PASS_SKY,
+		[sky, profiler]() {
+			GpuScope zone(profiler, "sky");
+			sky->draw();
+		});
 }
 
 void TrainView::loadShaders() {
+	PROFILE_FUNCTION();
 	if (!directional_light_shader) {
 		directional_light_shader = new Shader("../src/shaders/directional_light.vert", "../src/shaders/directional_light.frag");
 	}
@@ -843,19 +1332,108 @@ void TrainView::loadShaders() {
 	if (!interactiveHeightMap_shader) {
 		interactiveHeightMap_shader = new Shader("../src/shaders/interactive_heightmap.vert", "../src/shaders/interactive_heightmap.frag");
 	}
+
+	if (!batch_shader) {
+		batch_shader = new Shader("../src/shaders/batch_light.vert", "../src/shaders/batch_light.frag");
+	}
+
+	//same fragment shaders as the light shaders, the instance matrix comes from a vertex attribute
+	if (!directional_instanced_shader) {
+		directional_instanced_shader = new Shader("../src/shaders/instanced_light.vert", "../src/shaders/directional_light.frag");
+	}
+
+	if (!point_instanced_shader) {
+		point_instanced_shader = new Shader("../src/shaders/instanced_light.vert", "../src/shaders/point_light.frag");
+	}
+
+	if (!spot_instanced_shader) {
+		spot_instanced_shader = new Shader("../src/shaders/instanced_light.vert", "../src/shaders/spot_light.frag");
+	}
 	
 }
 
 void TrainView::loadModels() {
+	PROFILE_FUNCTION();
 	if (!sci_fi_train) {
 		sci_fi_train = new Model(FileSystem::getPath("resources/objects/Sci_fi_Train/Sci_fi_Train.obj"));
 	}
 	if (!teapot) {
 		teapot = new Model(FileSystem::getPath("resources/objects/teapot/teapot.obj"));
 	}
+	if (!staticBatch) {
+		// instance 0: train, instance 1: teapot (see drawStaticBatch)
+		staticBatch = new StaticBatch();
+		staticBatch->addInstance(staticBatch->addModel(sci_fi_train), trainModelMatrix());
+		staticBatch->addInstance(staticBatch->addModel(teapot), teapotModelMatrix());
+		staticBatch->build();
+	}
+}
+
+//the planet goes through the queue like any model, the rocks are one instanced draw per mesh
+void TrainView::drawAsteroids() {
+	PROFILE_FUNCTION();
+	if (!showAsteroids)
+		return;
+
+	if (!asteroidField) {
+		asteroidField = new AsteroidField(400.0f, 60.0f);
+		asteroidNode->setBounds(asteroidField->boundsMin(), asteroidField->boundsMax());
+	}
+	if (asteroidField->count != asteroidCount)
+		asteroidField->setCount(asteroidCount, asteroidNode->getWorld());
+
+	if (!asteroidNode->visible)
+		return;
+
+	renderQueue.submitModel(asteroidField->planet, current_light_shader, asteroidField->planetMatrix(asteroidNode->getWorld()), cameraState.position);
+
+	AsteroidField* field = asteroidField;
+	Shader* shader = current_instanced_shader;
+	GpuProfiler* profiler = gpuProfiler;
+	renderQueue.submitCustom(shader, glm::vec3(asteroidNode->getWorld()[3]), cameraState.position, PASS_SCENE,
+		[field, shader, profiler]() {
+			GpuScope zone(profiler, "asteroids");
+			field->drawRocks(*shader);
+		});
+}
+
+void TrainView::loadScene() {
+	if (trainNode)
+		return;
+
+	trainNode = sceneGraph.root->addChild(new SceneNode("train", sci_fi_train));
+	trainNode->setLocal(trainModelMatrix());
+
+	teapotNode = sceneGraph.root->addChild(new SceneNode("teapot", teapot));
+	teapotNode->setLocal(teapotModelMatrix());
+
+	glm::mat4 model = glm::mat4(1.0);
+	model = glm::translate(model, glm::vec3(0, 10, 0));
+	model = glm::scale(model, glm::vec3(10,1,10));
+	waterNode = sceneGraph.root->addChild(new SceneNode("water"));
+	waterNode->setLocal(model);
+
+	//bounds are set once the field is loaded
+	asteroidNode = sceneGraph.root->addChild(new SceneNode("asteroids"));
+	asteroidNode->setLocal(glm::translate(glm::mat4(1.0f), glm::vec3(0, 200, -1000)));
+}
+
+//update the scene graph and decide what the passes of this frame submit
+void TrainView::cullScene() {
+	PROFILE_FUNCTION();
+	//the grid is flat, its vertices are displaced in the shader:
+	//at most 100 * (1 + 5 interactive) * amplitude for the height maps, far less for the sine waves
+	float waveHeight = 600.0f * settings.waterAmplitude;
+	glm::vec3 lift(0.0f, waveHeight, 0.0f);
+	waterNode->setBounds(waterMesh->grid->boundsMin - lift, waterMesh->grid->boundsMax + lift);
+
+	sceneGraph.update();
+	sceneGraph.cull(cameraState.viewProjection);
+	LiveStats::setCulling(sceneGraph.drawnCount, sceneGraph.culledCount);
 }
 
 void TrainView::loadTextures() {
+	PROFILE_FUNCTION();
 	if (!ground_texture)
 		ground_texture = new Texture2D("../Images/black_white_board.png");
 	if (!water_texture)
@@ -863,18 +1441,21 @@ void TrainView::loadTextures() {
 }
 
 void TrainView::loadWaterMesh() {
+	PROFILE_FUNCTION();
 	if (!waterMesh) {
 		waterMesh = new WaterMesh(glm::vec3(0.0, 20.0, 0.0));
 	}
 }
 
 void TrainView::loadSkyBox() {
+	PROFILE_FUNCTION();
 	if (!skyBox) {
 		skyBox = new SkyBox();
 	}
 }
 
 void TrainView::initVAOs() {
+	PROFILE_FUNCTION();
 	if (!this->mainScreenVAO) {
 		float quadVertices[] = { // vertex attributes for a quad that fills the entire screen in Normalized Device Coordinates. NOTE that this plane is now much smaller and at the top left of the screen
 			// positions   // texCoords
@@ -894,6 +1475,7 @@ void TrainView::initVAOs() {
 		glBindVertexArray(mainScreenVAO->vao);
 		glBindBuffer(GL_ARRAY_BUFFER, mainScreenVAO->vbo[0]);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
+		GpuMemory::track(GL_BUFFER, mainScreenVAO->vbo[0], GPU_MEMORY_BUFFER, sizeof(quadVertices), "mainScreenVAO");
 		glEnableVertexAttribArray(0);
 		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
 		glEnableVertexAttribArray(1);
@@ -922,6 +1504,7 @@ void TrainView::initVAOs() {
 		glBindVertexArray(subScreenVAO->vao);
 		glBindBuffer(GL_ARRAY_BUFFER, subScreenVAO->vbo[0]);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
+		GpuMemory::track(GL_BUFFER, subScreenVAO->vbo[0], GPU_MEMORY_BUFFER, sizeof(quadVertices), "subScreenVAO");
 		glEnableVertexAttribArray(0);
 		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
 		glEnableVertexAttribArray(1);
@@ -950,6 +1533,7 @@ void TrainView::initVAOs() {
 		glBindVertexArray(interactiveHeightMapVAO->vao);
 		glBindBuffer(GL_ARRAY_BUFFER, interactiveHeightMapVAO->vbo[0]);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
+		GpuMemory::track(GL_BUFFER, interactiveHeightMapVAO->vbo[0], GPU_MEMORY_BUFFER, sizeof(quadVertices), "interactiveHeightMapVAO");
 		glEnableVertexAttribArray(0);
 		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
 		glEnableVertexAttribArray(1);
@@ -961,51 +1545,75 @@ void TrainView::initVAOs() {
 }
 
 void TrainView::initFBOs() {
-	if (!mainFBO) {
-		mainFBO = new FrameBuffer();
-		mainFBO->init(TEXTURE_WIDTH, TEXTURE_HEIGHT);
-	}
+	PROFILE_FUNCTION();
+	//scene targets, nothing samples their mips
+	FrameBufferDesc sceneDesc(TEXTURE_WIDTH, TEXTURE_HEIGHT, GL_RGBA8, false, true);
+	//picking uv, read back as floats
+	FrameBufferDesc uvDesc(TEXTURE_WIDTH, TEXTURE_HEIGHT, GL_RGBA16F, false, true);
+	//ripple simulation, r = height and g = velocity are signed, drawn as a full screen quad
+	FrameBufferDesc heightMapDesc(TEXTURE_WIDTH, TEXTURE_HEIGHT, GL_RG16F, false, false);
 
-	if (!subScreenFBO) {
-		subScreenFBO = new FrameBuffer();
-		subScreenFBO->init(TEXTURE_WIDTH, TEXTURE_HEIGHT);
-	}
+	if (!mainFBO)
+		mainFBO = fboPool.acquire(sceneDesc);
 
-	if (!colorUVFBO) {
-		colorUVFBO = new FrameBuffer();
-		colorUVFBO->init(TEXTURE_WIDTH, TEXTURE_HEIGHT);
-	}
+	if (!subScreenFBO)
+		subScreenFBO = fboPool.acquire(sceneDesc);
 
-	if (!interactiveHeightMapFBO0) {
-		interactiveHeightMapFBO0 = new FrameBuffer();
-		interactiveHeightMapFBO0->init(TEXTURE_WIDTH, TEXTURE_HEIGHT);
-	}
+	if (!colorUVFBO)
+		colorUVFBO = fboPool.acquire(uvDesc);
+
+	if (!interactiveHeightMapFBO0)
+		interactiveHeightMapFBO0 = fboPool.acquire(heightMapDesc);
 
 	if (!interactiveHeightMapFBO1) {
-		interactiveHeightMapFBO1 = new FrameBuffer();
-		interactiveHeightMapFBO1->init(TEXTURE_WIDTH, TEXTURE_HEIGHT);
+		interactiveHeightMapFBO1 = fboPool.acquire(heightMapDesc);
+		fboPool.printStats();
 	}
 }
 
+void TrainView::toggleRecording(RecordFormat format) {
+	if (frameRecorder->isRecording())
+		frameRecorder->stop();
+	else
+		frameRecorder->start("capture", format, settings.width, settings.height);
+}
+
+//bind mainFBO and render into the part of it the dynamic resolution allows
+void TrainView::bindMainFBO() {
+	mainFBO->bind();
+	glViewport(0, 0, dynamicResolution->getWidth(TEXTURE_WIDTH), dynamicResolution->getHeight(TEXTURE_HEIGHT));
+}
+
 void TrainView::drawMainFBO() {
+	PROFILE_FUNCTION();
 	glEnable(GL_DEPTH_TEST); // enable depth testing (is disabled for rendering screen-space quad)
 	// set the rendering destination to FBO
-	mainFBO->bind();
+	bindMainFBO();
 	// clear buffer
 	glClearColor(1, 1, 1, 1);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	drawTrain();
 
-	drawTeapot();
+	//objects only submit packets here, the queue decides the draw order
+	renderQueue.maxDepth = FAR;
+	renderQueue.begin(cameraState.viewProjection);
 
-	int waterType = tw->waveTypeBrowser->value();
-	drawWater(waterType);
+	if (useStaticBatch) {
+		drawStaticBatch();
+	}
+	else {
+		drawTrain();
+
+		drawTeapot();
+	}
+
+	int waterType = settings.waveType;
+	submitWater(waterType);
+
+	drawAsteroids();
 
-	glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
 	drawSkyBox();
-	glDepthFunc(GL_LESS); // set depth function back to default
 
-	glBindVertexArray(0);
+	flushRenderQueue();
 
 	// if MSAA is on, explicitly copy multi-sample color/depth buffers to single-sample
 	// it also generates mipmaps of color texture object
@@ -1013,24 +1621,37 @@ void TrainView::drawMainFBO() {
 
 	// back to normal window-system-provided framebuffer
 	mainFBO->unbind();
+	glViewport(0, 0, TEXTURE_WIDTH, TEXTURE_HEIGHT);
+}
+
+void TrainView::flushRenderQueue() {
+	renderQueue.flush(*dynamicBuffer);
+	frameDrawCount += renderQueue.drawCount;
+	frameProgramChanges += renderQueue.programChanges;
+	frameMaterialChanges += renderQueue.materialChanges;
 }
 
 void TrainView::drawSubScreenFBO() {
+	PROFILE_FUNCTION();
 	glEnable(GL_DEPTH_TEST); // enable depth testing (is disabled for rendering screen-space quad)
 	// set the rendering destination to FBO
 	subScreenFBO->bind();
 	// clear buffer
 	glClearColor(1, 1, 1, 1);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	renderQueue.begin(cameraState.viewProjection);
+
 	drawTrain();
 
 	drawTeapot();
 
-	int waterType = tw->waveTypeBrowser->value();
-	drawWater(waterType);
+	int waterType = settings.waveType;
+	submitWater(waterType);
 
 	drawSkyBox();
-	glBindVertexArray(0);
+
+	flushRenderQueue();
 
 	// if MSAA is on, explicitly copy multi-sample color/depth buffers to single-sample
 	// it also generates mipmaps of color texture object
@@ -1041,6 +1662,7 @@ void TrainView::drawSubScreenFBO() {
 }
 
 void TrainView::drawColorUVFBO() {
+	PROFILE_FUNCTION();
 	glEnable(GL_DEPTH_TEST); // enable depth testing (is disabled for rendering screen-space quad)
 	// set the rendering destination to FBO
 	colorUVFBO->bind();
@@ -1061,6 +1683,7 @@ void TrainView::drawColorUVFBO() {
 }
 
 void TrainView::updateInteractiveHeightMapFBO(int mode, glm::vec2 u_center) {
+	PROFILE_FUNCTION();
 	//mode 0: initialization, mode 1: drop, mode 2: update
 	// set the rendering destination to FBO
 	FrameBuffer* lastfbo;
@@ -1076,7 +1699,10 @@ void TrainView::updateInteractiveHeightMapFBO(int mode, glm::vec2 u_center) {
 		currentFBO = 0;
 	}
 
+	GpuScope zone(gpuProfiler, "interactive");
 	currentfbo->bind();
+	//the simulation always runs at full size, whatever the main pass uses
+	glViewport(0, 0, TEXTURE_WIDTH, TEXTURE_HEIGHT);
 
 	glDisable(GL_DEPTH_TEST);
 	// clear buffer
@@ -1118,17 +1744,24 @@ void TrainView::updateInteractiveHeightMapFBO(int mode, glm::vec2 u_center) {
 }
 
 void TrainView::drawMainScreen() {
+	PROFILE_FUNCTION();
 	glDisable(GL_DEPTH_TEST); // disable depth test so screen-space quad isn't discarded due to depth test.
 
 	mainScreen_shader->use();
 	mainScreen_shader->setFloat("vx_offset", 0.5);
-	mainScreen_shader->setFloat("rt_w", w());
-	mainScreen_shader->setFloat("rt_h", h());
+	mainScreen_shader->setFloat("rt_w", settings.width);
+	mainScreen_shader->setFloat("rt_h", settings.height);
 	mainScreen_shader->setFloat("pixel_w", 10.0);
 	mainScreen_shader->setFloat("pixel_h", 10.0);
-	mainScreen_shader->setBool("doPixelation", tw->pixelation->value());
-	mainScreen_shader->setBool("doOffset", tw->offset->value());
-	mainScreen_shader->setBool("doGrayscale", tw->grayscale->value());
+	mainScreen_shader->setBool("doPixelation", settings.pixelation);
+	mainScreen_shader->setBool("doOffset", settings.offset);
+	mainScreen_shader->setBool("doGrayscale", settings.grayscale);
+	//only the rendered part of mainFBO is stretched over the screen
+	mainScreen_shader->setVec2("uvScale",
+		(float)dynamicResolution->getWidth(TEXTURE_WIDTH) / TEXTURE_WIDTH,
+		(float)dynamicResolution->getHeight(TEXTURE_HEIGHT) / TEXTURE_HEIGHT);
+	mainScreen_shader->setVec2("texelSize", 1.0f / TEXTURE_WIDTH, 1.0f / TEXTURE_HEIGHT);
+	mainScreen_shader->setBool("doBicubic", dynamicResolution->getScale() < 1.0f);
 	
 
 	glBindVertexArray(mainScreenVAO->vao);
@@ -1138,6 +1771,7 @@ void TrainView::drawMainScreen() {
 }
 
 void TrainView::drawSubScreen() {
+	PROFILE_FUNCTION();
 	glDisable(GL_DEPTH_TEST); // disable depth test so screen-space quad isn't discarded due to depth test.
 
 	subScreen_shader->use();
@@ -132,18 +132,21 @@ TrainWindow(const int x, const int y)
 		waterAmplitude->value(1);
 		waterAmplitude->align(FL_ALIGN_LEFT);
 		waterAmplitude->type(FL_HORIZONTAL);
+		waterAmplitude->callback((Fl_Callback*)damageCB, this);
 		pty += 25;
 		waterWaveLength = new Fl_Value_Slider(675, pty, 120, 20, "Wave length");
 		waterWaveLength->range(0, 10);
 		waterWaveLength->value(5);
 		waterWaveLength->align(FL_ALIGN_LEFT);
 		waterWaveLength->type(FL_HORIZONTAL);
+		waterWaveLength->callback((Fl_Callback*)damageCB, this);
 		pty += 25;
 		waterSpeed = new Fl_Value_Slider(675, pty, 120, 20, "Wave Speed");
 		waterSpeed->range(0, 10);
 		waterSpeed->value(5);
 		waterSpeed->align(FL_ALIGN_LEFT);
 		waterSpeed->type(FL_HORIZONTAL);
+		waterSpeed->callback((Fl_Callback*)damageCB, this);
 
 		pty += 30;
 
@@ -209,8 +212,12 @@ void TrainWindow::
 damageMe()
 //========================================================================
 {
-	if (trainView->selectedCube >= ((int)m_Track.points.size()))
-		trainView->selectedCube = 0;
+	//the selection belongs to the thread that renders
+	trainView->runOnRenderThread([this]() {
+		if (trainView->selectedCube >= ((int)m_Track.points.size()))
+			trainView->selectedCube = 0;
+	});
+	trainView->queueSettings();
 	trainView->damage(1);
 }
 
@@ -0,0 +1,27 @@
+#include "TransformBuffer.h"
+
+void TransformBuffer::begin(const glm::mat4& viewProjection) {
+	this->viewProjection = viewProjection;
+	transforms.clear();
+}
+
+unsigned int TransformBuffer::add(const glm::mat4& model) {
+	transforms.push_back(make(model, viewProjection));
+	return (unsigned int)transforms.size() - 1;
+}
+
+void TransformBuffer::upload(RingBuffer& ring) {
+	if (transforms.empty())
+		return;
+
+	RingAllocation allocation = ring.upload(transforms.data(), transforms.size() * sizeof(DrawTransform), ring.getStorageAlignment());
+	ring.bindRange(GL_SHADER_STORAGE_BUFFER, TRANSFORM_BUFFER_BINDING, allocation);
+}
+
+DrawTransform TransformBuffer::make(const glm::mat4& model, const glm::mat4& viewProjection) {
+	DrawTransform transform;
+	transform.model = model;
+	transform.mvp = viewProjection * model;
+	transform.normal = glm::mat4(glm::transpose(glm::inverse(glm::mat3(model))));
+	return transform;
+}
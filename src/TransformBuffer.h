@@ -0,0 +1,41 @@
+#pragma once
+#include<vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "RingBuffer.h"
+
+using namespace std;
+
+//shaders read the DrawTransforms SSBO at this binding, indexed by the drawIndex uniform
+#define TRANSFORM_BUFFER_BINDING 4
+
+//std430 layout of one DrawTransforms entry, the normal matrix is kept as a mat4
+//so every member stays 16 byte aligned
+struct DrawTransform
+{
+	glm::mat4 model;
+	glm::mat4 mvp;
+	glm::mat4 normal;
+};
+
+//Matrices of every object drawn in a pass, computed once on the CPU.
+//Replaces the per-draw model uniform and the per-vertex transpose(inverse(model)).
+class TransformBuffer
+{
+public:
+	void begin(const glm::mat4& viewProjection);
+	//returns the index the shader uses to find this transform
+	unsigned int add(const glm::mat4& model);
+	//copy into the ring buffer and bind it to TRANSFORM_BUFFER_BINDING
+	void upload(RingBuffer& ring);
+
+	static DrawTransform make(const glm::mat4& model, const glm::mat4& viewProjection);
+
+	unsigned int size() const { return (unsigned int)transforms.size(); }
+
+private:
+	glm::mat4 viewProjection = glm::mat4(1.0f);
+	vector<DrawTransform> transforms;
+};
@@ -0,0 +1,39 @@
+#pragma once
+#include<atomic>
+
+using namespace std;
+
+//Lock-free triple buffer for one writer and one reader thread.
+//the writer fills back() and publish()es it, the reader update()s and reads front().
+//neither ever waits: there is always a third slot to swap with, and the reader simply
+//skips the values published in between. a slot is never written while it is read.
+template<typename T>
+class TripleBuffer
+{
+public:
+	//writer side
+	T& back()				{ return slots[backIndex]; }
+	void publish() {
+		backIndex = middle.exchange(backIndex | FRESH, memory_order_acq_rel) & INDEX;
+	}
+
+	//reader side, true when something newer was published since the last update
+	bool update() {
+		if (!(middle.load(memory_order_relaxed) & FRESH))
+			return false;
+		frontIndex = middle.exchange(frontIndex, memory_order_acq_rel) & INDEX;
+		return true;
+	}
+	const T& front() const	{ return slots[frontIndex]; }
+	//the reader may keep notes in the slot it holds, the writer sees them when it gets it back
+	T& front()				{ return slots[frontIndex]; }
+
+private:
+	static const int INDEX = 3;
+	static const int FRESH = 4;		//middle holds a value the reader has not seen
+
+	T slots[3] = {};
+	atomic<int> middle{ 1 };
+	int backIndex = 0;		//writer only
+	int frontIndex = 2;		//reader only
+};
@@ -233,20 +233,13 @@ void unsetupShadows(void)
 //   plane, so we can be a little more well-balanced
 //   this code mimics page 147 of the OpenGL book
 //===============================================================================
-int getMouseLine(double& x1, double& y1, double& z1,
+int getMouseLine(int x, int iy,
+								 const double mat1[16], const double mat2[16],
+								 const int viewport[4],
+								 double& x1, double& y1, double& z1,
 								 double& x2, double& y2, double& z2)
 //===============================================================================
 {
-  int x = Fl::event_x();
-  int iy = Fl::event_y();
-
-  double mat1[16],mat2[16];		// we have to deal with the projection matrices
-  int viewport[4];
-
-  glGetIntegerv(GL_VIEWPORT, viewport);
-  glGetDoublev(GL_MODELVIEW_MATRIX,mat1);
-  glGetDoublev(GL_PROJECTION_MATRIX,mat2);
-
   int y = viewport[3] - iy; // originally had an extra -1?
 
   int i1 = gluUnProject((double) x, (double) y, .25, mat1, mat2, viewport, &x1, &y1, &z1);
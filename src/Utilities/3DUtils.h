@@ -103,7 +103,12 @@ void unsetupShadows(void);
 // Given the position of the mouse in 2D, we need to figure out where
 // it is in 3D. of course, its not in one place, its a line
 // this function gets that ray for you (well, it gets 2 points on the line)
-int getMouseLine(double& p1x, double& p1y, double& p1z,
+// the caller passes the matrices and viewport it drew with (column major),
+// so nothing has to be read back from OpenGL
+int getMouseLine(int mx, int my,
+								 const double modelview[16], const double projection[16],
+								 const int viewport[4],
+								 double& p1x, double& p1y, double& p1z,
 								 double& p2x, double& p2y, double& p2z);
 			  
 //************************************************************************
@@ -124,16 +124,16 @@ setProjection(bool doClear)
 	  glLoadIdentity();
 
   // Compute the aspect ratio so we don't distort things
-  double aspect = ((double) wind->w()) / ((double) wind->h());
-  gluPerspective(fieldOfView, aspect, .1, 1000);
+  float aspect = ((float) wind->w()) / ((float) wind->h());
+  HMatrix p;
+  getProjectionMatrix(p, aspect);
+  glMultMatrixf((float*) p);
 
   // Put the camera where we want it to be
   glMatrixMode(GL_MODELVIEW);
-  glLoadIdentity();
-
-  // Use the transformation in the ArcBall
-  glTranslatef(-eyeX, -eyeY, -eyeZ);
-  multMatrix();
+  HMatrix v;
+  getViewMatrix(v);
+  glLoadMatrixf((float*) v);
 }
 
 //**************************************************************************
@@ -256,6 +256,47 @@ getMatrix(HMatrix m) const
 	qAll.toMatrix(m);
 }
 
+//**************************************************************************
+//
+// * The view matrix: translate(-eye) * rotation of the ball
+//==========================================================================
+void ArcBallCam::
+getViewMatrix(HMatrix m) const
+//==========================================================================
+{
+	HMatrix r;
+	getMatrix(r);
+	for (int c = 0; c < 4; c++) {
+		m[c][0] = r[c][0] - eyeX * r[c][3];
+		m[c][1] = r[c][1] - eyeY * r[c][3];
+		m[c][2] = r[c][2] - eyeZ * r[c][3];
+		m[c][3] = r[c][3];
+	}
+}
+
+//**************************************************************************
+//
+// * The projection matrix, same as gluPerspective(fieldOfView, aspect, .1, 1000)
+//==========================================================================
+void ArcBallCam::
+getProjectionMatrix(HMatrix m, float aspect) const
+//==========================================================================
+{
+	const float zNear = .1f;
+	const float zFar = 1000.0f;
+	float f = 1.0f / tanf(fieldOfView * 3.14159265f / 360.0f);
+
+	for (int c = 0; c < 4; c++)
+		for (int r = 0; r < 4; r++)
+			m[c][r] = 0;
+
+	m[0][0] = f / aspect;
+	m[1][1] = f;
+	m[2][2] = (zFar + zNear) / (zNear - zFar);
+	m[2][3] = -1;
+	m[3][2] = 2 * zFar * zNear / (zNear - zFar);
+}
+
 //**************************************************************************
 //
 // * a simplified interface - so you never see the insides of arcball
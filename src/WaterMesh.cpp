@@ -1,11 +1,13 @@
 #include "WaterMesh.h"
+#include "CpuProfiler.h"
+#include "LiveStats.h"
+#include "JobSystem.h"
 #include <string>
 
 using namespace std;
 
 WaterMesh::WaterMesh(glm::vec3 pos) :
 	waveCounter(0),
-	previousTime(0),
 	currentTime(0),
 	position(pos),
 	amplitude_coefficient(1.0)
@@ -62,11 +64,8 @@ void WaterMesh::setMVP(glm::mat4 m, glm::mat4 v, glm::mat4 p) {
 	projectionMatrix = p;
 }
 
-void WaterMesh::addTime(float delta_t) {
-	currentTime += delta_t;
-}
-
 void WaterMesh::draw(int mode) {
+	PROFILE_FUNCTION();
 	if (mode == 1) {
 		drawSineWave();
 	}
@@ -83,33 +82,25 @@ void WaterMesh::draw(int mode) {
 }
 
 void WaterMesh::drawSineWave() {
+	PROFILE_FUNCTION();
 	sinWave_shader->use();
-	sinWave_shader->setMat4("model", modelMatrix);
-	sinWave_shader->setMat4("view", viewMatrix);
-	sinWave_shader->setMat4("projection", projectionMatrix);
-
-	sinWave_shader->setFloat("time", currentTime);
-	sinWave_shader->setInt("numWaves", waveCounter);
-
-	GLfloat amplitude[MAX_WAVE];
-	GLfloat waveLength[MAX_WAVE];
-	GLfloat speed[MAX_WAVE];
-	for (int i = 0; i < MAX_WAVE; ++i) {
-		amplitude[i] = waves.amplitude[i] * amplitude_coefficient;
-		waveLength[i] = waves.waveLength[i] * waveLength_coefficient / 5.0;
-		speed[i] = waves.speed[i] * speed_coefficient / 5.0;
-	}
-
-	glUniform1fv(glGetUniformLocation(sinWave_shader->ID, "amplitude"), MAX_WAVE, amplitude);
-	glUniform1fv(glGetUniformLocation(sinWave_shader->ID, "wavelength"), MAX_WAVE, waveLength);
-	glUniform1fv(glGetUniformLocation(sinWave_shader->ID, "speed"), MAX_WAVE, speed);
-	for (int i = 0; i != MAX_WAVE; i++) {
-		string name = "direction[";
-		name += to_string(i);
-		name += "]";
-		GLint originsLoc = glGetUniformLocation(sinWave_shader->ID, name.c_str());
-		glUniform2f(originsLoc, waves.direction[i].x, waves.direction[i].y);
+	sinWave_shader->setInt("drawIndex", drawIndex);
+
+	//all wave parameters go up as one block instead of 4 * MAX_WAVE uniform calls
+	RingAllocation params = dynamicBuffer->allocateUniform(sizeof(WaveParams));
+	if (params.ptr) {
+		WaveParams* dst = (WaveParams*)params.ptr;
+		for (int i = 0; i < MAX_WAVE; ++i) {
+			dst->waves[i] = glm::vec4(waves.amplitude[i] * amplitude_coefficient,
+				waves.waveLength[i] * waveLength_coefficient / 5.0,
+				waves.speed[i] * speed_coefficient / 5.0,
+				0.0f);
+			dst->directions[i] = glm::vec4(waves.direction[i], 0.0f, 0.0f);
+		}
+		dst->time = currentTime;
+		dst->numWaves = waveCounter;
 	}
+	dynamicBuffer->bindRange(GL_UNIFORM_BUFFER, WAVE_PARAMS_BINDING, params);
 
 	sinWave_shader->setVec3("EyePos", eyePos);
 	sinWave_shader->setVec3("light.direction", -1.0f, -1.0f, -0.0f);
@@ -125,24 +116,15 @@ void WaterMesh::drawSineWave() {
 }
 
 void WaterMesh::drawHeightMap() {
+	PROFILE_FUNCTION();
 	heightMap_shader->use();
-	heightMap_shader->setMat4("model", modelMatrix);
-	heightMap_shader->setMat4("view", viewMatrix);
-	heightMap_shader->setMat4("projection", projectionMatrix);
+	heightMap_shader->setInt("drawIndex", drawIndex);
 	heightMap_shader->setInt("heightMap", 1);
 	heightMap_shader->setInt("interactive", 2);
 	heightMap_shader->setFloat("amplitude", amplitude_coefficient);
 	heightMap_shader->setBool("doInteractive", false);
 
-	//check if we shoud change the heightMap after a period of time
-	if (currentTime - previousTime >= 16) {
-		if (heightMap_counter == HEIGHTMAP_NUM - 1) {
-			heightMap_counter = 0;
-		}
-		else {
-			++heightMap_counter;
-		}
-	};
+	//heightMap_counter is the Simulation's, it plays the sequence after 16 seconds
 
 	heightMap_textures[heightMap_counter]->bind(1);
 
@@ -164,24 +146,15 @@ void WaterMesh::drawHeightMap() {
 }
 
 void WaterMesh::drawInteractiveWave() {
+	PROFILE_FUNCTION();
 	heightMap_shader->use();
-	heightMap_shader->setMat4("model", modelMatrix);
-	heightMap_shader->setMat4("view", viewMatrix);
-	heightMap_shader->setMat4("projection", projectionMatrix);
+	heightMap_shader->setInt("drawIndex", drawIndex);
 	heightMap_shader->setInt("heightMap", 1);
 	heightMap_shader->setInt("interactive", 2);
 	heightMap_shader->setFloat("amplitude", amplitude_coefficient);
 	heightMap_shader->setBool("doInteractive", true);
 
-	//check if we shoud change the heightMap after a period of time
-	if (currentTime - previousTime >= 16) {
-		if (heightMap_counter == HEIGHTMAP_NUM - 1) {
-			heightMap_counter = 0;
-		}
-		else {
-			++heightMap_counter;
-		}
-	};
+	//heightMap_counter is the Simulation's, it plays the sequence after 16 seconds
 
 	heightMap_textures[heightMap_counter]->bind(1);
 
@@ -205,25 +178,38 @@ void WaterMesh::drawInteractiveWave() {
 }
 
 void WaterMesh::loadHeightMaps() {
+	PROFILE_FUNCTION();
 	heightMap_textures.resize(HEIGHTMAP_NUM);
+	//the PNGs decode on the workers, each hands its upload to the main thread
+	JobCounter loaded;
+	int uploaded = 0;
 	for (int i = 0; i < HEIGHTMAP_NUM; ++i) {
-		string path = "../Images/heightMaps/";
-		string number;
-		if (i / 10 == 0) {
-			number = "00" + to_string(i);
-		}
-		else if (i / 100 == 0) {
-			number = "0" + to_string(i);
-		}
-		else {
-			number = to_string(i);
-		}
-		path = path + number + ".png";
-		heightMap_textures[i] = new Texture2D(path.c_str());
+		JobSystem::run([this, i, &loaded, &uploaded]() {
+			PROFILE_ZONE("decode heightmap");
+			string path = "../Images/heightMaps/";
+			string number;
+			if (i / 10 == 0) {
+				number = "00" + to_string(i);
+			}
+			else if (i / 100 == 0) {
+				number = "0" + to_string(i);
+			}
+			else {
+				number = to_string(i);
+			}
+			path = path + number + ".png";
+			cv::Mat img = cv::imread(path, cv::IMREAD_COLOR);
+			JobSystem::runOnMainThread([this, i, img, path, &uploaded]() {
+				heightMap_textures[i] = new Texture2D(img, path, Texture2D::TEXTURE_DEFAULT, GPU_MEMORY_HEIGHTMAP);
+				LiveStats::setLoadProgress("heightmaps", ++uploaded, HEIGHTMAP_NUM);
+			}, &loaded);
+		}, &loaded);
 	}
+	JobSystem::wait(loaded);
 }
 
 void WaterMesh::drawColorUV() {
+	PROFILE_FUNCTION();
 	color_uv_shader->use();
 	color_uv_shader->setMat4("model", modelMatrix);
 	color_uv_shader->setMat4("view", viewMatrix);
@@ -6,6 +6,7 @@
 #include "learnopengl/filesystem.h"
 #include <learnopengl/shader_m.h>
 #include "RenderUtilities/Texture.h"
+#include "RingBuffer.h"
 
 
 #include <glad/glad.h>
@@ -28,6 +29,17 @@ struct Wave
 	glm::vec2 direction[MAX_WAVE];
 };
 
+//std140 layout of the WaveParams block in water_surface.vert
+#define WAVE_PARAMS_BINDING 1
+struct WaveParams
+{
+	glm::vec4 waves[MAX_WAVE];		//x amplitude, y wavelength, z speed
+	glm::vec4 directions[MAX_WAVE];
+	GLfloat time;
+	GLint numWaves;
+	GLfloat pad[2];
+};
+
 class WaterMesh
 {
 public:
@@ -38,6 +50,11 @@ public:
 	Shader* heightMap_shader = nullptr;
 	Shader* color_uv_shader = nullptr;
 
+	//per-frame upload buffer, owned by TrainView
+	RingBuffer* dynamicBuffer = nullptr;
+	//entry in the DrawTransforms buffer used by the sine wave and height map shaders
+	int drawIndex = 0;
+
 	//sine wave
 	void initWaves();
 	void addSineWave(float waveLength, float amplitude, float speed, glm::vec2 direction);
@@ -66,9 +83,8 @@ public:
 	void draw(int mode);
 	void setMVP(glm::mat4 m, glm::mat4 v, glm::mat4 p);
 	void setEyePos(glm::vec3 eye_pos);
-	void addTime(float delta_t);
 
-	float previousTime = 0;
+	//set from the Simulation every frame
 	float currentTime = 0;
 	glm::vec3 position;
 	glm::vec3 eyePos;
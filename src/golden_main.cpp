@@ -0,0 +1,328 @@
+/************************************************************************
+	 File:        golden_main.cpp
+
+	 Comment:
+						Entry point of WaterSurfaceGolden.
+						Renders the scenes of a Benchmark script offscreen with a
+						fixed timestep and checks the last frame of each against a
+						stored golden image, and its frame time, render queue draws
+						and GL calls against a budget file. Exits with 1 if any scene
+						fails, so a rendering change can be merged knowing the picture
+						is the same and the frame really got cheaper.
+						A scene without a golden image fails too, unless
+						--allow-missing reports it as NO REFERENCE and checks only
+						its budgets; --update on the reference machine writes the
+						missing ones.
+
+						Images are compared in CIELAB: a pixel differs when its
+						colour distance (delta E 1976) is over --pixel-tolerance,
+						a scene fails when the mean distance is over --tolerance or
+						more than --max-pixels percent of its pixels differ.
+
+	 Usage:
+						WaterSurfaceGolden [--width W] [--height H] [--dt seconds]
+							[--scenes scenes.txt] [--golden dir] [--budgets budgets.txt]
+							[--out dir] [--filter text] [--update] [--allow-missing]
+							[--tolerance dE] [--pixel-tolerance dE] [--max-pixels percent]
+						--out gets <scene>.png and <scene>_diff.png of failed scenes
+						--update writes the goldens instead of checking them
+
+*************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "TrainWindow.H"
+#include "TrainView.H"
+#include "HeadlessContext.h"
+#include "Benchmark.h"
+#include "GlCallCounter.h"
+
+struct GoldenOptions
+{
+	int width = 640;
+	int height = 360;
+	float deltaTime = 1.0f / 60.0f;
+	const char* scenesPath = "../resources/golden/scenes.txt";
+	const char* goldenDir = "../resources/golden";
+	const char* budgetsPath = "../resources/golden/budgets.txt";
+	const char* outDir = ".";
+	const char* filter = nullptr;
+	bool update = false;
+	bool allowMissing = false;		//scenes without a golden pass on their budgets
+	float tolerance = 1.0f;			//mean delta E
+	float pixelTolerance = 10.0f;	//delta E of one pixel
+	float maxPixels = 0.5f;			//percent of the pixels over pixelTolerance
+};
+
+//outcome of the image check of one scene
+enum GoldenImageResult
+{
+	GOLDEN_IMAGE_SAME,
+	GOLDEN_IMAGE_DIFFERENT,
+	GOLDEN_IMAGE_MISSING,	//no golden to compare with, a failure without --allow-missing
+};
+
+//what a scene measured, by budget metric name
+typedef map<string, float> GoldenMetrics;
+
+static bool parseOptions(int argc, char** argv, GoldenOptions& options)
+{
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "--width") && hasValue)
+			options.width = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--height") && hasValue)
+			options.height = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--dt") && hasValue)
+			options.deltaTime = (float)atof(argv[++i]);
+		else if (!strcmp(argv[i], "--scenes") && hasValue)
+			options.scenesPath = argv[++i];
+		else if (!strcmp(argv[i], "--golden") && hasValue)
+			options.goldenDir = argv[++i];
+		else if (!strcmp(argv[i], "--budgets") && hasValue)
+			options.budgetsPath = argv[++i];
+		else if (!strcmp(argv[i], "--out") && hasValue)
+			options.outDir = argv[++i];
+		else if (!strcmp(argv[i], "--filter") && hasValue)
+			options.filter = argv[++i];
+		else if (!strcmp(argv[i], "--update"))
+			options.update = true;
+		else if (!strcmp(argv[i], "--allow-missing"))
+			options.allowMissing = true;
+		else if (!strcmp(argv[i], "--tolerance") && hasValue)
+			options.tolerance = (float)atof(argv[++i]);
+		else if (!strcmp(argv[i], "--pixel-tolerance") && hasValue)
+			options.pixelTolerance = (float)atof(argv[++i]);
+		else if (!strcmp(argv[i], "--max-pixels") && hasValue)
+			options.maxPixels = (float)atof(argv[++i]);
+		else {
+			printf("unknown option %s\n", argv[i]);
+			return false;
+		}
+	}
+	return options.width > 0 && options.height > 0;
+}
+
+//<scene> <metric> <max> lines, # comments
+static bool loadBudgets(const char* path, map<string, GoldenMetrics>& budgets)
+{
+	ifstream file(path);
+	if (!file) {
+		printf("WaterSurfaceGolden: can't open %s\n", path);
+		return false;
+	}
+	string line;
+	int lineNumber = 0;
+	while (getline(file, line)) {
+		lineNumber++;
+		istringstream tokens(line);
+		string scene, metric;
+		float limit;
+		if (!(tokens >> scene) || scene[0] == '#')
+			continue;
+		if (!(tokens >> metric >> limit)) {
+			printf("WaterSurfaceGolden: %s:%d: can't read \"%s\"\n", path, lineNumber, line.c_str());
+			return false;
+		}
+		budgets[scene][metric] = limit;
+	}
+	return true;
+}
+
+//the last frame of the target, top row first, BGR like cv::imread
+static cv::Mat readTarget(FrameBuffer* target, int width, int height)
+{
+	target->copyColorBuffer();
+	cv::Mat rgba(height, width, CV_8UC4, (void*)target->getColorBuffer());
+	cv::Mat bgr;
+	cv::cvtColor(rgba, bgr, cv::COLOR_RGBA2BGR);
+	cv::flip(bgr, bgr, 0);
+	return bgr;
+}
+
+//delta E 1976 of every pixel, in a CV_32F image
+static cv::Mat colorDistance(const cv::Mat& a, const cv::Mat& b)
+{
+	cv::Mat labA, labB;
+	a.convertTo(labA, CV_32FC3, 1 / 255.0);
+	b.convertTo(labB, CV_32FC3, 1 / 255.0);
+	cv::cvtColor(labA, labA, cv::COLOR_BGR2Lab);
+	cv::cvtColor(labB, labB, cv::COLOR_BGR2Lab);
+	cv::Mat difference = labA - labB;
+	difference = difference.mul(difference);
+	vector<cv::Mat> channels;
+	cv::split(difference, channels);
+	cv::Mat distance;
+	cv::sqrt(channels[0] + channels[1] + channels[2], distance);
+	return distance;
+}
+
+//different if the image differs more than the tolerances allow, writes the diff then
+static GoldenImageResult compareImage(const string& scene, const cv::Mat& image, const GoldenOptions& options, string& report)
+{
+	string goldenPath = string(options.goldenDir) + "/" + scene + ".png";
+	cv::Mat golden = cv::imread(goldenPath, cv::IMREAD_COLOR);
+	char text[256];
+	if (golden.empty()) {
+		report = "no golden " + goldenPath + " (run with --update)";
+		return GOLDEN_IMAGE_MISSING;
+	}
+	if (golden.size() != image.size()) {
+		snprintf(text, sizeof(text), "golden is %dx%d, the frame %dx%d", golden.cols, golden.rows, image.cols, image.rows);
+		report = text;
+		return GOLDEN_IMAGE_DIFFERENT;
+	}
+
+	cv::Mat distance = colorDistance(image, golden);
+	double meanDistance = cv::mean(distance)[0];
+	double differing = 100.0 * cv::countNonZero(distance > options.pixelTolerance) / (double)distance.total();
+	snprintf(text, sizeof(text), "mean dE %.3f, %.3f%% of pixels over dE %.1f", meanDistance, differing, options.pixelTolerance);
+	report = text;
+	if (meanDistance <= options.tolerance && differing <= options.maxPixels)
+		return GOLDEN_IMAGE_SAME;
+
+	//the frame and its differences, bright where they are largest
+	string out = string(options.outDir) + "/" + scene;
+	cv::Mat diff;
+	distance.convertTo(diff, CV_8U, 255.0 / max(options.pixelTolerance * 2.0f, 1.0f));
+	cv::applyColorMap(diff, diff, cv::COLORMAP_JET);
+	cv::imwrite(out + ".png", image);
+	cv::imwrite(out + "_diff.png", diff);
+	return GOLDEN_IMAGE_DIFFERENT;
+}
+
+//false if a metric is over its budget
+static bool checkBudgets(const string& scene, const GoldenMetrics& measured, const map<string, GoldenMetrics>& budgets, string& report)
+{
+	auto found = budgets.find(scene);
+	if (found == budgets.end()) {
+		report = "no budgets";
+		return true;
+	}
+	bool ok = true;
+	char text[128];
+	for (const auto& budget : found->second) {
+		auto value = measured.find(budget.first);
+		if (value == measured.end()) {
+			//GL calls of a build without WATERSURFACE_GL_TRACE, or a typo
+			snprintf(text, sizeof(text), "%s not measured, ", budget.first.c_str());
+			report += text;
+			continue;
+		}
+		bool over = value->second > budget.second;
+		snprintf(text, sizeof(text), "%s %g/%g%s, ", budget.first.c_str(), value->second, budget.second, over ? " OVER" : "");
+		report += text;
+		ok = ok && !over;
+	}
+	if (report.size() >= 2)
+		report.resize(report.size() - 2);
+	return ok;
+}
+
+int main(int argc, char** argv)
+{
+	GoldenOptions options;
+	if (!parseOptions(argc, argv, options)) {
+		printf("usage: WaterSurfaceGolden [--width W] [--height H] [--dt seconds] [--scenes scenes.txt] [--golden dir] [--budgets budgets.txt] [--out dir] [--filter text] [--update] [--allow-missing] [--tolerance dE] [--pixel-tolerance dE] [--max-pixels percent]\n");
+		return 1;
+	}
+
+	Benchmark scenes;
+	map<string, GoldenMetrics> budgets;
+	if (!scenes.load(options.scenesPath) || !loadBudgets(options.budgetsPath, budgets))
+		return 1;
+
+	HeadlessContext glContext;
+	if (!glContext.create(options.width, options.height))
+		return 1;
+
+	TrainWindow tw;
+	TrainView* view = tw.trainView;
+	view->audioEnabled = false;
+	view->publishStats = false;
+	view->simulationThread = false;
+	view->initGL(glContext.getLoader());
+	//the goldens are rendered at full resolution, whatever the frame time
+	view->dynamicResolution->enabled = false;
+	printf("WaterSurfaceGolden: %s, %s, %dx%d%s\n", glContext.getBackendName(), (const char*)glGetString(GL_RENDERER),
+		options.width, options.height, GlCallCounter::isInstalled() ? ", GL calls counted" : "");
+
+	FrameBuffer* target = view->fboPool.acquire(FrameBufferDesc(options.width, options.height, GL_RGBA8, false, false));
+	if (!target)
+		return 1;
+
+	int failed = 0, checked = 0, unreferenced = 0;
+	for (BenchmarkScenario& scene : scenes.scenarios) {
+		if (options.filter && scene.name.find(options.filter) == string::npos)
+			continue;
+
+		for (int frame = 0; frame < scene.warmupFrames + scene.frames; frame++) {
+			RenderSettings settings = view->captureSettings();
+			settings.width = options.width;
+			settings.height = options.height;
+			settings.deltaTime = options.deltaTime;
+			settings.targetFramebuffer = target->getId();
+			scenes.apply(scene, frame, *view, settings);
+
+			auto start = chrono::high_resolution_clock::now();
+			view->renderFrame(settings);
+			glFinish();
+			auto finished = chrono::high_resolution_clock::now();
+			if (frame >= scene.warmupFrames)
+				scenes.record(scene, chrono::duration<float, milli>(finished - start).count(), view->passTimings, view->gpuProfiler->getResults());
+		}
+
+		GoldenMetrics measured;
+		measured["frame_ms"] = percentile(scene.frameMs, 50);
+		measured["queue_draws"] = (float)view->frameDrawCount;
+		if (GlCallCounter::isInstalled()) {
+			const GlCallStats& calls = GlCallCounter::getLastFrame();
+			measured["gl_total"] = (float)calls.total;
+			for (int kind = 0; kind < GL_CALL_KIND_COUNT; kind++)
+				measured[string("gl_") + glCallKindNames[kind]] = (float)calls.calls[kind];
+		}
+
+		cv::Mat image = readTarget(target, options.width, options.height);
+		checked++;
+		if (options.update) {
+			string goldenPath = string(options.goldenDir) + "/" + scene.name + ".png";
+			if (!cv::imwrite(goldenPath, image)) {
+				printf("WaterSurfaceGolden: can't write %s\n", goldenPath.c_str());
+				return 1;
+			}
+			printf("%-20s updated %s\n", scene.name.c_str(), goldenPath.c_str());
+			//a starting point for the budget file, with some headroom
+			if (budgets.find(scene.name) == budgets.end())
+				for (const auto& value : measured)
+					printf("    %s %s %g\n", scene.name.c_str(), value.first.c_str(),
+						value.first == "frame_ms" ? value.second * 1.25f : value.second);
+			continue;
+		}
+
+		string imageReport, budgetReport;
+		GoldenImageResult imageResult = compareImage(scene.name, image, options, imageReport);
+		bool budgetOk = checkBudgets(scene.name, measured, budgets, budgetReport);
+		bool imageOk = imageResult == GOLDEN_IMAGE_SAME || (imageResult == GOLDEN_IMAGE_MISSING && options.allowMissing);
+		bool ok = imageOk && budgetOk;
+		const char* status = !ok ? "FAIL" : imageResult == GOLDEN_IMAGE_MISSING ? "NO REFERENCE" : "PASS";
+		printf("%-20s %s  image: %s\n%-20s       budget: %s\n", scene.name.c_str(), status,
+			imageReport.c_str(), "", budgetReport.c_str());
+		if (!ok)
+			failed++;
+		if (imageResult == GOLDEN_IMAGE_MISSING)
+			unreferenced++;
+	}
+
+	if (!options.update)
+		printf("WaterSurfaceGolden: %d of %d scenes failed, %d without a golden image\n", failed, checked, unreferenced);
+	return failed ? 1 : 0;
+}
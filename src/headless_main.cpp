@@ -0,0 +1,213 @@
+/************************************************************************
+	 File:        headless_main.cpp
+
+	 Comment:
+						Entry point of WaterSurfaceHeadless.
+						Renders the same TrainView passes as the window, into an
+						offscreen target, for a fixed number of frames and exits.
+
+	 Usage:
+						WaterSurfaceHeadless [--width W] [--height H] [--frames N]
+							[--dt seconds] [--run] [--dump prefix] [--timings file.csv]
+							[--benchmark default|script.txt] [--json results.json]
+							[--memory file.txt] [--replay input_log.wsil]
+						--benchmark plays the scenarios instead of --frames plain frames
+						and writes frame/pass percentiles to --json
+						--memory writes the GPU memory estimate after the last frame
+						--replay plays a recorded input log ('i' in WaterSurface) with
+						its delta times, one frame per recorded frame
+
+*************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <vector>
+
+#include "TrainWindow.H"
+#include "TrainView.H"
+#include "HeadlessContext.h"
+#include "Benchmark.h"
+#include "GpuMemory.h"
+
+struct HeadlessOptions
+{
+	int width = 1280;
+	int height = 720;
+	int frames = 300;
+	float deltaTime = 1.0f / 60.0f;
+	bool runTrain = false;
+	const char* dumpPrefix = nullptr;
+	const char* timingsPath = nullptr;
+	const char* benchmark = nullptr;
+	const char* jsonPath = "benchmark.json";
+	const char* memoryPath = nullptr;
+	const char* replayPath = nullptr;
+};
+
+static bool parseOptions(int argc, char** argv, HeadlessOptions& options)
+{
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "--width") && hasValue)
+			options.width = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--height") && hasValue)
+			options.height = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--frames") && hasValue)
+			options.frames = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--dt") && hasValue)
+			options.deltaTime = (float)atof(argv[++i]);
+		else if (!strcmp(argv[i], "--run"))
+			options.runTrain = true;
+		else if (!strcmp(argv[i], "--dump") && hasValue)
+			options.dumpPrefix = argv[++i];
+		else if (!strcmp(argv[i], "--timings") && hasValue)
+			options.timingsPath = argv[++i];
+		else if (!strcmp(argv[i], "--benchmark") && hasValue)
+			options.benchmark = argv[++i];
+		else if (!strcmp(argv[i], "--json") && hasValue)
+			options.jsonPath = argv[++i];
+		else if (!strcmp(argv[i], "--memory") && hasValue)
+			options.memoryPath = argv[++i];
+		else if (!strcmp(argv[i], "--replay") && hasValue)
+			options.replayPath = argv[++i];
+		else {
+			printf("unknown option %s\n", argv[i]);
+			return false;
+		}
+	}
+	return options.width > 0 && options.height > 0 && options.frames > 0;
+}
+
+int main(int argc, char** argv)
+{
+	HeadlessOptions options;
+	if (!parseOptions(argc, argv, options)) {
+		printf("usage: WaterSurfaceHeadless [--width W] [--height H] [--frames N] [--dt seconds] [--run] [--dump prefix] [--timings file.csv] [--benchmark default|script.txt] [--json results.json] [--memory file.txt] [--replay input_log.wsil]\n");
+		return 1;
+	}
+
+	HeadlessContext glContext;
+	if (!glContext.create(options.width, options.height))
+		return 1;
+
+	//the window is never shown, it only holds the track and the widget state the passes read
+	TrainWindow tw;
+	TrainView* view = tw.trainView;
+	view->audioEnabled = false;
+	view->publishStats = false;
+	view->simulationThread = false;
+	view->initGL(glContext.getLoader());
+	//the scale follows the GPU's speed, the frames and timings of different machines must compare
+	view->dynamicResolution->enabled = false;
+	if (options.replayPath) {
+		if (!view->startInputReplay(options.replayPath))
+			return 1;
+		options.frames = view->inputLog.getFrameCount();
+	}
+	printf("WaterSurfaceHeadless: %s, %s, %dx%d, %d frames\n",
+		glContext.getBackendName(), (const char*)glGetString(GL_RENDERER), options.width, options.height, options.frames);
+
+	FrameBuffer* target = view->fboPool.acquire(FrameBufferDesc(options.width, options.height, GL_RGBA8, false, false));
+	if (!target)
+		return 1;
+
+	if (options.dumpPrefix)
+		view->frameRecorder->start(options.dumpPrefix, RECORD_PNG, options.width, options.height);
+	if (options.runTrain)
+		tw.runButton->value(1);
+
+	if (options.benchmark) {
+		Benchmark benchmark;
+		if (!strcmp(options.benchmark, "default"))
+			benchmark.loadDefault();
+		else if (!benchmark.load(options.benchmark))
+			return 1;
+
+		for (BenchmarkScenario& scenario : benchmark.scenarios) {
+			for (int frame = 0; frame < scenario.warmupFrames + scenario.frames; frame++) {
+				if (options.runTrain)
+					tw.advanceTrain();
+
+				RenderSettings settings = view->captureSettings();
+				settings.width = options.width;
+				settings.height = options.height;
+				settings.deltaTime = options.deltaTime;
+				settings.targetFramebuffer = target->getId();
+				benchmark.apply(scenario, frame, *view, settings);
+
+				auto start = std::chrono::high_resolution_clock::now();
+				view->renderFrame(settings);
+				glFinish();
+				auto finished = std::chrono::high_resolution_clock::now();
+
+				if (frame >= scenario.warmupFrames)
+					benchmark.record(scenario, std::chrono::duration<float, std::milli>(finished - start).count(), view->passTimings, view->gpuProfiler->getResults());
+			}
+		}
+
+		view->frameRecorder->stop();
+		if (options.memoryPath)
+			GpuMemory::dump(options.memoryPath);
+		benchmark.printSummary();
+		return benchmark.writeJson(options.jsonPath, (const char*)glGetString(GL_RENDERER),
+			options.width, options.height, options.deltaTime) ? 0 : 1;
+	}
+
+	std::vector<float> cpuMs, frameMs;
+	cpuMs.reserve(options.frames);
+	frameMs.reserve(options.frames);
+	for (int frame = 0; frame < options.frames; frame++) {
+		if (options.runTrain)
+			tw.advanceTrain();
+
+		//fixed timestep: the same frames on every machine, however slow
+		RenderSettings settings = view->captureSettings();
+		settings.width = options.width;
+		settings.height = options.height;
+		settings.deltaTime = options.deltaTime;
+		settings.targetFramebuffer = target->getId();
+		//the recorded events, widgets and delta time, at this size
+		if (options.replayPath) {
+			view->replayInputFrame(settings);
+			settings.width = options.width;
+			settings.height = options.height;
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		view->renderFrame(settings);
+		auto submitted = std::chrono::high_resolution_clock::now();
+		//no swap to pace the frames, wait for the GPU so each one is measured on its own
+		glFinish();
+		auto finished = std::chrono::high_resolution_clock::now();
+
+		cpuMs.push_back(std::chrono::duration<float, std::milli>(submitted - start).count());
+		frameMs.push_back(std::chrono::duration<float, std::milli>(finished - start).count());
+	}
+
+	view->frameRecorder->stop();
+
+	float cpuTotal = 0, frameTotal = 0;
+	for (int i = 0; i < options.frames; i++) {
+		cpuTotal += cpuMs[i];
+		frameTotal += frameMs[i];
+	}
+	printf("WaterSurfaceHeadless: cpu %.3f ms, frame %.3f ms on average\n",
+		cpuTotal / options.frames, frameTotal / options.frames);
+	if (options.memoryPath)
+		GpuMemory::dump(options.memoryPath);
+
+	if (options.timingsPath) {
+		std::ofstream timings(options.timingsPath);
+		if (!timings) {
+			printf("can't write %s\n", options.timingsPath);
+			return 1;
+		}
+		timings << "frame,cpu_ms,frame_ms\n";
+		for (int i = 0; i < options.frames; i++)
+			timings << i << "," << cpuMs[i] << "," << frameMs[i] << "\n";
+	}
+	return 0;
+}
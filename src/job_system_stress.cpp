@@ -0,0 +1,159 @@
+/************************************************************************
+	 File:        job_system_stress.cpp
+
+	 Comment:
+						Entry point of JobSystemStress.
+						Runs the JobSystem through the patterns the loaders and
+						the frame use, many rounds over, and checks every result:
+						parallelFor inside parallelFor, jobs started after other
+						jobs, GL style work handed to the main thread, and more
+						jobs pushed from one thread than a deque's first ring holds.
+						Exits with 1 at the first wrong result, so races in the
+						deques or the counters show up as a failed run.
+
+	 Usage:
+						JobSystemStress [--rounds N] [--workers N]
+						--workers 0 is one per core but one, like the application
+
+*************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <vector>
+
+#include "JobSystem.h"
+
+struct StressOptions
+{
+	int rounds = 200;
+	int workers = 0;
+};
+
+static bool parseOptions(int argc, char** argv, StressOptions& options)
+{
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "--rounds") && hasValue)
+			options.rounds = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--workers") && hasValue)
+			options.workers = atoi(argv[++i]);
+		else {
+			printf("unknown option %s\n", argv[i]);
+			return false;
+		}
+	}
+	return options.rounds > 0 && options.workers >= 0;
+}
+
+static bool check(bool ok, const char* test, int round, const char* what)
+{
+	if (!ok)
+		printf("JobSystemStress: %s, round %d: %s\n", test, round, what);
+	return ok;
+}
+
+//every index of an outer parallelFor runs an inner one, like the per-object work of a frame
+static bool nestedParallelFor(int round)
+{
+	const int outer = 64, inner = 1000;
+	vector<atomic<int>> visits(outer * inner);
+	for (atomic<int>& visit : visits)
+		visit = 0;
+	JobSystem::parallelFor(0, outer, 3, [&](int first, int last) {
+		for (int i = first; i < last; i++)
+			JobSystem::parallelFor(0, inner, 37, [&, i](int innerFirst, int innerLast) {
+				for (int j = innerFirst; j < innerLast; j++)
+					visits[i * inner + j].fetch_add(1, memory_order_relaxed);
+			});
+	});
+	for (atomic<int>& visit : visits)
+		if (!check(visit.load() == 1, "nested parallelFor", round, "an index did not run exactly once"))
+			return false;
+	return true;
+}
+
+//stages chained with after: each stage reads what all jobs of the one before wrote
+static bool afterDependencies(int round)
+{
+	const int stages = 8, jobs = 32;
+	vector<int> values(stages * jobs, 0);
+	vector<JobCounter> counters(stages);
+	atomic<int> wrongInputs{ 0 };
+	for (int stage = 0; stage < stages; stage++) {
+		JobCounter* after = stage > 0 ? &counters[stage - 1] : nullptr;
+		for (int job = 0; job < jobs; job++)
+			JobSystem::run([&, stage, job]() {
+				int input = 0;
+				if (stage > 0)
+					for (int i = 0; i < jobs; i++)
+						input += values[(stage - 1) * jobs + i];
+				if (input != (stage > 0 ? jobs * stage : 0))
+					wrongInputs.fetch_add(1, memory_order_relaxed);
+				values[stage * jobs + job] = stage + 1;
+			}, &counters[stage], after);
+	}
+	JobSystem::wait(counters[stages - 1]);
+	if (!check(wrongInputs.load() == 0, "after", round, "a job started before the stage it waited for"))
+		return false;
+
+	//a counter that is already done starts the job right away
+	JobCounter done, late;
+	bool ran = false;
+	JobSystem::run([&ran]() { ran = true; }, &late, &done);
+	JobSystem::wait(late);
+	return check(ran, "after", round, "a job after a done counter did not run");
+}
+
+//jobs hand their GL part to the main thread, which runs it while it waits
+static bool mainThreadJobs(int round)
+{
+	const int jobs = 256;
+	JobCounter counter;
+	atomic<int> ran{ 0 }, offMain{ 0 };
+	for (int job = 0; job < jobs; job++)
+		JobSystem::run([&]() {
+			JobSystem::runOnMainThread([&]() {
+				if (!JobSystem::isMainThread())
+					offMain.fetch_add(1, memory_order_relaxed);
+				ran.fetch_add(1, memory_order_relaxed);
+			}, &counter);
+		}, &counter);
+	JobSystem::wait(counter);
+	return check(ran.load() == jobs, "main thread jobs", round, "not every main thread job ran") &&
+		check(offMain.load() == 0, "main thread jobs", round, "a main thread job ran on a worker");
+}
+
+//more jobs from one thread than the first ring of its deque holds (256), on the main thread and a worker
+static bool ringGrowth(int round)
+{
+	const int jobs = 5000;
+	JobCounter counter;
+	atomic<int> ran{ 0 };
+	for (int job = 0; job < jobs; job++)
+		JobSystem::run([&ran]() { ran.fetch_add(1, memory_order_relaxed); }, &counter);
+	JobSystem::run([&]() {
+		for (int job = 0; job < jobs; job++)
+			JobSystem::run([&ran]() { ran.fetch_add(1, memory_order_relaxed); }, &counter);
+	}, &counter);
+	JobSystem::wait(counter);
+	return check(ran.load() == jobs * 2, "ring growth", round, "jobs got lost or ran twice");
+}
+
+int main(int argc, char** argv)
+{
+	StressOptions options;
+	if (!parseOptions(argc, argv, options)) {
+		printf("usage: JobSystemStress [--rounds N] [--workers N]\n");
+		return 1;
+	}
+
+	JobSystem::start(options.workers);
+	for (int round = 0; round < options.rounds; round++) {
+		if (!nestedParallelFor(round) || !afterDependencies(round) || !mainThreadJobs(round) || !ringGrowth(round))
+			return 1;
+	}
+	printf("JobSystemStress: %d rounds on %d workers passed\n", options.rounds, JobSystem::getWorkerCount());
+	return 0;
+}
@@ -24,6 +24,9 @@
 
 #include "stdio.h"
 #include "TrainWindow.H"
+#include "CpuProfiler.h"
+#include "LiveStats.h"
+#include "TrainView.H"
 
 #pragma warning(push)
 #pragma warning(disable:4312)
@@ -37,8 +40,28 @@ int main(int argc, char** argv)
 {
 	printf("CS559 Train Assignment\n");
 	glutInit(&argc, argv);
+	//FlTk's thread support, the render thread wakes the UI with Fl::awake()
+	Fl::lock();
 	TrainWindow tw;
 	tw.show();
 
 	Fl::run();
+	//the render thread may be waiting for the lock (overlay text), and nothing else runs now
+	Fl::unlock();
+	//a recording still running finishes its readbacks and file in the context that made them,
+	//the render thread applies the queued stop before it exits
+	TrainView* view = tw.trainView;
+	if (view->frameRecorder)
+		view->runOnRenderThread([view]() {
+			view->frameRecorder->stop();
+			delete view->frameRecorder;
+			view->frameRecorder = nullptr;
+		});
+	//the render thread still uses the simulation
+	if (tw.trainView->renderThread)
+		tw.trainView->renderThread->stop();
+	if (tw.trainView->simulation)
+		tw.trainView->simulation->stop();
+	(void)PROFILE_WRITE("cpu_trace.json");
+	LiveStats::close();
 }
\ No newline at end of file
@@ -0,0 +1,343 @@
+/************************************************************************
+	 File:        micro_bench.cpp
+
+	 Comment:
+						Entry point of WaterSurfaceMicroBench.
+						Times the CPU hot paths outside of the renderer, no window
+						and no GL context: track files, model conversion, heightmap
+						decoding and the point math of dragging control points.
+						Each case is warmed up, then repeated; every repetition is
+						one sample of the time per operation.
+
+	 Usage:
+						WaterSurfaceMicroBench [--reps N] [--warmup N] [--points N]
+							[--filter text] [--json results.json]
+						--points is the control point count of the large track
+						--filter only runs the cases whose name contains text
+
+*************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <learnopengl/filesystem.h>
+#include <learnopengl/model.h>
+
+#include "Track.H"
+#include "Utilities/Pnt3f.H"
+#include "Utilities/3DUtils.h"
+
+//Track.cpp, not in Track.H
+void breakString(char* str, std::vector<const char*>& words);
+
+struct MicroBenchOptions
+{
+	int reps = 30;
+	int warmup = 3;
+	int points = 50000;
+	const char* filter = nullptr;
+	const char* jsonPath = nullptr;
+};
+
+struct MicroBenchResult
+{
+	std::string name;
+	int operations = 0;				//per repetition
+	std::vector<double> nsPerOperation;	//one per repetition
+};
+
+//results nobody reads, so the compiler can't drop the work
+static volatile double sink = 0;
+
+static double percentile(std::vector<double> values, double p) {
+	if (values.empty())
+		return 0.0;
+	std::sort(values.begin(), values.end());
+	size_t rank = (size_t)(p / 100.0 * values.size() + 0.5);
+	rank = std::min(std::max(rank, (size_t)1), values.size());
+	return values[rank - 1];
+}
+
+static double mean(const std::vector<double>& values) {
+	double sum = 0;
+	for (double value : values)
+		sum += value;
+	return values.empty() ? 0.0 : sum / values.size();
+}
+
+static double deviation(const std::vector<double>& values) {
+	if (values.size() < 2)
+		return 0.0;
+	double average = mean(values), sum = 0;
+	for (double value : values)
+		sum += (value - average) * (value - average);
+	return std::sqrt(sum / (values.size() - 1));
+}
+
+class MicroBench
+{
+public:
+	MicroBench(const MicroBenchOptions& options) : options(options) {}
+
+	//body does operations operations per call, it is called warmup + reps times
+	void run(const std::string& name, int operations, const std::function<void()>& body) {
+		if (options.filter && name.find(options.filter) == std::string::npos)
+			return;
+		MicroBenchResult result;
+		result.name = name;
+		result.operations = operations;
+		for (int i = 0; i < options.warmup; i++)
+			body();
+		for (int i = 0; i < options.reps; i++) {
+			auto start = std::chrono::high_resolution_clock::now();
+			body();
+			auto finished = std::chrono::high_resolution_clock::now();
+			result.nsPerOperation.push_back(std::chrono::duration<double, std::nano>(finished - start).count() / operations);
+		}
+		printf("%-32s %12.1f %12.1f %10.1f%%\n", name.c_str(), percentile(result.nsPerOperation, 50),
+			mean(result.nsPerOperation), 100.0 * deviation(result.nsPerOperation) / std::max(mean(result.nsPerOperation), 1e-9));
+		results.push_back(result);
+	}
+
+	bool writeJson(const char* path) const {
+		std::ofstream json(path);
+		if (!json) {
+			printf("WaterSurfaceMicroBench: can't write %s\n", path);
+			return false;
+		}
+		char text[256];
+		json << "{\n";
+		json << "  \"reps\": " << options.reps << ",\n";
+		json << "  \"warmup\": " << options.warmup << ",\n";
+		json << "  \"points\": " << options.points << ",\n";
+		json << "  \"cases\": [\n";
+		for (size_t i = 0; i < results.size(); i++) {
+			const std::vector<double>& ns = results[i].nsPerOperation;
+			snprintf(text, sizeof(text), "{\"mean\": %.3f, \"stddev\": %.3f, \"min\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"max\": %.3f}",
+				mean(ns), deviation(ns), percentile(ns, 0), percentile(ns, 50), percentile(ns, 95), percentile(ns, 100));
+			json << "    {\n";
+			json << "      \"name\": \"" << results[i].name << "\",\n";
+			json << "      \"operations\": " << results[i].operations << ",\n";
+			json << "      \"ns_per_operation\": " << text << "\n";
+			json << "    }" << (i + 1 < results.size() ? ",\n" : "\n");
+		}
+		json << "  ]\n";
+		json << "}\n";
+		return true;
+	}
+
+private:
+	MicroBenchOptions options;
+	std::vector<MicroBenchResult> results;
+};
+
+static bool parseOptions(int argc, char** argv, MicroBenchOptions& options)
+{
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "--reps") && hasValue)
+			options.reps = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--warmup") && hasValue)
+			options.warmup = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--points") && hasValue)
+			options.points = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--filter") && hasValue)
+			options.filter = argv[++i];
+		else if (!strcmp(argv[i], "--json") && hasValue)
+			options.jsonPath = argv[++i];
+		else {
+			printf("unknown option %s\n", argv[i]);
+			return false;
+		}
+	}
+	//readPoints refuses more than 65535 points
+	return options.reps > 0 && options.warmup >= 0 && options.points >= 4 && options.points <= 65535;
+}
+
+//a track of count points on a noisy loop, with orientations
+static void makeTrack(CTrack& track, int count)
+{
+	track.points.clear();
+	for (int i = 0; i < count; i++) {
+		float angle = 6.2831853f * i / count;
+		Pnt3f pos(100.0f * cosf(angle), 5.0f + 3.0f * sinf(7.0f * angle), 100.0f * sinf(angle));
+		Pnt3f orient(0.1f * sinf(3.0f * angle), 1.0f, 0.1f * cosf(5.0f * angle));
+		orient.normalize();
+		track.points.push_back(ControlPoint(pos, orient));
+	}
+}
+
+static void benchTrack(MicroBench& bench, const MicroBenchOptions& options)
+{
+	const char* path = "micro_bench_track.txt";
+	CTrack track;
+	makeTrack(track, options.points);
+
+	bench.run("track/write_points", options.points, [&]() {
+		track.writePoints(path);
+	});
+	track.writePoints(path);
+	bench.run("track/read_points", options.points, [&]() {
+		track.readPoints(path);
+		sink = sink + track.points.back().pos.x;
+	});
+
+	//the lines of the file, copied again each time since breakString writes into them
+	std::vector<std::string> lines;
+	for (const ControlPoint& point : track.points) {
+		char line[256];
+		snprintf(line, sizeof(line), "%g %g %g %g %g %g\n",
+			point.pos.x, point.pos.y, point.pos.z, point.orient.x, point.orient.y, point.orient.z);
+		lines.push_back(line);
+	}
+	std::vector<char> buffer(256);
+	std::vector<const char*> words;
+	bench.run("track/break_string", (int)lines.size(), [&]() {
+		size_t total = 0;
+		for (const std::string& line : lines) {
+			memcpy(buffer.data(), line.c_str(), line.size() + 1);
+			breakString(buffer.data(), words);
+			total += words.size();
+		}
+		sink = sink + total;
+	});
+	remove(path);
+}
+
+static void benchModels(MicroBench& bench)
+{
+	const char* names[] = { "rock", "planet", "teapot", "nanosuit", "cyborg", "trains/train1", "Sci_fi_Train/Sci_fi_Train" };
+	for (const char* name : names) {
+		std::string file = strchr(name, '/') ? name : std::string(name) + "/" + name;
+		std::string path = FileSystem::getPath("resources/objects/" + file + ".obj");
+		//the import is assimp's, the conversion to our vertices is what Model adds
+		Assimp::Importer importer;
+		const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+			printf("WaterSurfaceMicroBench: can't import %s, skipped\n", path.c_str());
+			continue;
+		}
+		int vertexCount = 0;
+		for (unsigned int i = 0; i < scene->mNumMeshes; i++)
+			vertexCount += scene->mMeshes[i]->mNumVertices;
+
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		bench.run("model/convert/" + std::string(strrchr(file.c_str(), '/') + 1), std::max(vertexCount, 1), [&]() {
+			for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+				vertices.clear();
+				indices.clear();
+				Model::convertMesh(scene->mMeshes[i], vertices, indices);
+				sink = sink + indices.size();
+			}
+		});
+	}
+}
+
+static void benchHeightMaps(MicroBench& bench)
+{
+	//the first ten of WaterMesh::loadHeightMaps, decoded the way Texture2D does
+	std::vector<std::string> paths;
+	for (int i = 0; i < 10; i++) {
+		char name[64];
+		snprintf(name, sizeof(name), "Images/heightMaps/%03d.png", i);
+		paths.push_back(FileSystem::getPath(name));
+	}
+	if (cv::imread(paths[0], cv::IMREAD_COLOR).empty()) {
+		printf("WaterSurfaceMicroBench: can't read %s, skipped\n", paths[0].c_str());
+		return;
+	}
+	bench.run("heightmap/decode_png", (int)paths.size(), [&]() {
+		for (const std::string& path : paths) {
+			cv::Mat img = cv::imread(path, cv::IMREAD_COLOR);
+			sink = sink + img.cols;
+		}
+	});
+}
+
+static void benchPoints(MicroBench& bench)
+{
+	const int count = 100000;
+	std::vector<Pnt3f> a(count), b(count);
+	for (int i = 0; i < count; i++) {
+		a[i] = Pnt3f((float)(i % 17), (float)(i % 5) + 1.0f, (float)(i % 11));
+		b[i] = Pnt3f((float)(i % 3) + 0.5f, (float)(i % 13), (float)(i % 7) - 2.0f);
+	}
+	bench.run("pnt3f/cross_scale_add", count, [&]() {
+		Pnt3f sum;
+		for (int i = 0; i < count; i++)
+			sum = sum + 0.5f * (a[i] * b[i]) + b[i] * 0.25f;
+		sink = sink + sum.x + sum.y + sum.z;
+	});
+	std::vector<Pnt3f> normals(a);
+	bench.run("pnt3f/normalize", count, [&]() {
+		for (int i = 0; i < count; i++) {
+			normals[i] = a[i];
+			normals[i].normalize();
+		}
+		sink = sink + normals[count - 1].x;
+	});
+}
+
+static void benchMousePole(MicroBench& bench)
+{
+	//the world camera looking at the track from above and behind, as TrainView sets it up
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 80.0f, 150.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1280.0f / 720.0f, 0.1f, 1000.0f);
+	double modelview[16], proj[16];
+	for (int i = 0; i < 16; i++) {
+		modelview[i] = glm::value_ptr(view)[i];
+		proj[i] = glm::value_ptr(projection)[i];
+	}
+	const int viewport[4] = { 0, 0, 1280, 720 };
+
+	const int count = 10000;
+	bench.run("mouse/get_mouse_line", count, [&]() {
+		double x1, y1, z1, x2, y2, z2, total = 0;
+		for (int i = 0; i < count; i++) {
+			getMouseLine(i % 1280, (i * 7) % 720, modelview, proj, viewport, x1, y1, z1, x2, y2, z2);
+			total += x2 - x1;
+		}
+		sink = sink + total;
+	});
+	bench.run("mouse/mouse_pole_go", count, [&]() {
+		double rx, ry, rz, total = 0;
+		for (int i = 0; i < count; i++) {
+			double t = i * 0.001;
+			mousePoleGo(t, 80.0, 150.0, 0.5 * t, 20.0 - t, 40.0, 10.0, 5.0, -10.0, rx, ry, rz, (i & 1) != 0);
+			total += rx + ry + rz;
+		}
+		sink = sink + total;
+	});
+}
+
+int main(int argc, char** argv)
+{
+	MicroBenchOptions options;
+	if (!parseOptions(argc, argv, options)) {
+		printf("usage: WaterSurfaceMicroBench [--reps N] [--warmup N] [--points N] [--filter text] [--json results.json]\n");
+		return 1;
+	}
+
+	MicroBench bench(options);
+	printf("%-32s %12s %12s %11s\n", "case", "p50 ns/op", "mean ns/op", "stddev");
+	benchTrack(bench, options);
+	benchModels(bench);
+	benchHeightMaps(bench);
+	benchPoints(bench);
+	benchMousePole(bench);
+
+	if (options.jsonPath && !bench.writeJson(options.jsonPath))
+		return 1;
+	return 0;
+}
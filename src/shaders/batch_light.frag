@@ -0,0 +1,72 @@
+#version 430 core
+out vec4 FragColor;
+
+// same light model as directional_light, point_light and spot_light,
+// selected with lightType (1: directional, 2: point, 3: spot)
+struct Material {
+    float shininess;
+};
+
+struct Light {
+    vec3 position;
+    vec3 direction;
+    float cutOff;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+flat in uint MaterialIndex;
+
+uniform vec3 viewPos;
+uniform Material material;
+uniform Light light;
+uniform int lightType;
+
+// one layer per material
+uniform sampler2DArray diffuseMaps;
+uniform sampler2DArray specularMaps;
+
+void main()
+{
+    vec3 diffuseColor = texture(diffuseMaps, vec3(TexCoords, float(MaterialIndex))).rgb;
+    vec3 specularColor = texture(specularMaps, vec3(TexCoords, float(MaterialIndex))).rgb;
+
+    vec3 norm = normalize(Normal);
+    vec3 lightDir = (lightType == 1) ? normalize(-light.direction) : normalize(light.position - FragPos);
+
+    vec3 ambient = light.ambient * diffuseColor;
+
+    // outside the spotlight cone only the ambient term is left
+    if (lightType == 3 && dot(lightDir, normalize(-light.direction)) <= light.cutOff) {
+        FragColor = vec4(ambient, 1.0);
+        return;
+    }
+
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+
+    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    vec3 specular = light.specular * spec * specularColor;
+
+    if (lightType != 1) {
+        float distance    = length(light.position - FragPos);
+        float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+        if (lightType == 2)
+            ambient *= attenuation;
+        diffuse  *= attenuation;
+        specular *= attenuation;
+    }
+
+    FragColor = vec4(ambient + diffuse + specular, 1.0);
+}
@@ -0,0 +1,44 @@
+#version 430 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 5) in uint aDrawID; // baseInstance of the indirect command
+
+struct DrawParams {
+    uint transformIndex;
+    uint materialIndex;
+    uint pad0;
+    uint pad1;
+};
+
+struct DrawTransform {
+    mat4 model;
+    mat4 mvp;
+    mat4 normal;
+};
+
+layout (std430, binding = 2) readonly buffer Transforms {
+    DrawTransform transforms[];
+};
+
+layout (std430, binding = 3) readonly buffer Params {
+    DrawParams params[];
+};
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+flat out uint MaterialIndex;
+
+void main()
+{
+    DrawParams p = params[aDrawID];
+    DrawTransform t = transforms[p.transformIndex];
+
+    FragPos = vec3(t.model * vec4(aPos, 1.0));
+    Normal = mat3(t.normal) * aNormal;
+    TexCoords = aTexCoords;
+    MaterialIndex = p.materialIndex;
+
+    gl_Position = t.mvp * vec4(aPos, 1.0);
+}
@@ -1,4 +1,4 @@
-#version 330 core
+#version 430 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
@@ -7,15 +7,24 @@ out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+struct DrawTransform {
+    mat4 model;
+    mat4 mvp;
+    mat4 normal;
+};
+
+//filled once per frame on the CPU, see TransformBuffer.h
+layout (std430, binding = 4) readonly buffer DrawTransforms {
+    DrawTransform drawTransforms[];
+};
+uniform int drawIndex;
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;  
+    DrawTransform t = drawTransforms[drawIndex];
+    FragPos = vec3(t.model * vec4(aPos, 1.0));
+    Normal = mat3(t.normal) * aNormal;  
     TexCoords = aTexCoords;
     
-    gl_Position = projection * view * vec4(FragPos, 1.0);
+    gl_Position = t.mvp * vec4(aPos, 1.0);
 }
\ No newline at end of file
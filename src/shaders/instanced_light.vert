@@ -0,0 +1,26 @@
+#version 430 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 5) in mat4 aInstanceMatrix; // locations 5-8, see INSTANCE_MATRIX_LOCATION
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+//written once per frame by TrainView::setUBO
+layout (std140, binding = 0) uniform Matrices
+{
+    mat4 projection;
+    mat4 view;
+};
+
+void main()
+{
+    FragPos = vec3(aInstanceMatrix * vec4(aPos, 1.0));
+    //instances are only rotated and uniformly scaled, the model matrix is fine for normals
+    Normal = mat3(aInstanceMatrix) * aNormal;
+    TexCoords = aTexCoords;
+
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
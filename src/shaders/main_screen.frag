@@ -8,8 +8,54 @@ uniform float pixel_h = 10.0; // 10.0
 uniform bool doPixelation;
 uniform bool doOffset;
 uniform bool doGrayscale;
+// dynamic resolution: the scene only covers uvScale of sceneTex
+uniform vec2 uvScale = vec2(1.0, 1.0);
+uniform vec2 texelSize; // 1 / size of sceneTex
+uniform bool doBicubic; // upscale with Catmull-Rom instead of bilinear
 in vec2 TexCoords;
 
+// 9 bilinear taps instead of 16 point taps, the middle taps share their weights
+vec3 catmullRom(vec2 uv, vec2 lo, vec2 hi)
+{
+  vec2 samplePos = uv / texelSize;
+  vec2 texPos1 = floor(samplePos - 0.5) + 0.5;
+  vec2 f = samplePos - texPos1;
+
+  vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+  vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+  vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+  vec2 w3 = f * f * (-0.5 + 0.5 * f);
+  vec2 w12 = w1 + w2;
+
+  // keep the outer taps inside the rendered part of the texture
+  vec2 p0 = clamp((texPos1 - 1.0) * texelSize, lo, hi);
+  vec2 p3 = clamp((texPos1 + 2.0) * texelSize, lo, hi);
+  vec2 p12 = clamp((texPos1 + w2 / w12) * texelSize, lo, hi);
+
+  vec3 result = vec3(0.0);
+  result += textureLod(sceneTex, vec2(p0.x,  p0.y), 0.0).rgb * w0.x * w0.y;
+  result += textureLod(sceneTex, vec2(p12.x, p0.y), 0.0).rgb * w12.x * w0.y;
+  result += textureLod(sceneTex, vec2(p3.x,  p0.y), 0.0).rgb * w3.x * w0.y;
+  result += textureLod(sceneTex, vec2(p0.x,  p12.y), 0.0).rgb * w0.x * w12.y;
+  result += textureLod(sceneTex, vec2(p12.x, p12.y), 0.0).rgb * w12.x * w12.y;
+  result += textureLod(sceneTex, vec2(p3.x,  p12.y), 0.0).rgb * w3.x * w12.y;
+  result += textureLod(sceneTex, vec2(p0.x,  p3.y), 0.0).rgb * w0.x * w3.y;
+  result += textureLod(sceneTex, vec2(p12.x, p3.y), 0.0).rgb * w12.x * w3.y;
+  result += textureLod(sceneTex, vec2(p3.x,  p3.y), 0.0).rgb * w3.x * w3.y;
+  return max(result, 0.0);
+}
+
+// uv in [0,1] over the screen, mapped into the rendered part of sceneTex
+vec3 sampleScene(vec2 uv)
+{
+  vec2 lo = texelSize * 0.5;
+  vec2 hi = uvScale - texelSize * 0.5;
+  vec2 st = clamp(uv * uvScale, lo, hi);
+  if (doBicubic)
+    return catmullRom(st, lo, hi);
+  return texture(sceneTex, st).rgb;
+}
+
 void main() 
 {
   vec2 uv = TexCoords.xy;
@@ -21,19 +67,19 @@ void main()
       float dy = pixel_h*(1./rt_h);
       vec2 coord = vec2(dx*floor(uv.x/dx),
                         dy*floor(uv.y/dy));
-      tc = texture2D(sceneTex, coord).rgb;
+      tc = sampleScene(coord);
     }
     else if (uv.x>=(vx_offset+0.005))
     {
-      tc = texture2D(sceneTex, uv).rgb;
+      tc = sampleScene(uv);
     }
   }else{
-    tc = texture2D(sceneTex, uv).rgb;
+    tc = sampleScene(uv);
   }
 
   if(doOffset){
     float time = 1.0f;
-    tc = texture( sceneTex, uv + 0.005*vec2( sin(time+1024.0*uv.x),cos(time+768.0*uv.y)) ).xyz;
+    tc = sampleScene(uv + 0.005*vec2( sin(time+1024.0*uv.x),cos(time+768.0*uv.y)) );
   }
 
   if(doGrayscale){
@@ -1,4 +1,4 @@
-#version 330 core
+#version 430 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
@@ -6,9 +6,17 @@ layout (location = 2) in vec2 aTexCoords;
 out vec3 FragPos;
 smooth out vec3 Normal;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+struct DrawTransform {
+    mat4 model;
+    mat4 mvp;
+    mat4 normal;
+};
+
+//filled once per frame on the CPU, see TransformBuffer.h
+layout (std430, binding = 4) readonly buffer DrawTransforms {
+    DrawTransform drawTransforms[];
+};
+uniform int drawIndex;
 
 const float pi = 3.14159;
 uniform vec3 EyePos;
@@ -60,9 +68,10 @@ void main()
     }
 
     
-    FragPos = vec3(model * vec4(temp_pos, 1.0));
+    DrawTransform t = drawTransforms[drawIndex];
+    FragPos = vec3(t.model * vec4(temp_pos, 1.0));
     Normal = waveNormal(texture_coordinate);
-    Normal = mat3(transpose(inverse(model))) * Normal;
+    Normal = mat3(t.normal) * Normal;
 
-    gl_Position = projection * view * model * vec4(temp_pos, 1.0);
+    gl_Position = t.mvp * vec4(temp_pos, 1.0);
 }
\ No newline at end of file
@@ -1,4 +1,4 @@
-#version 330 core
+#version 430 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
@@ -7,26 +7,41 @@ out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+struct DrawTransform {
+    mat4 model;
+    mat4 mvp;
+    mat4 normal;
+};
+
+//filled once per frame on the CPU, see TransformBuffer.h
+layout (std430, binding = 4) readonly buffer DrawTransforms {
+    DrawTransform drawTransforms[];
+};
+uniform int drawIndex;
 
 const float pi = 3.14159;
-uniform float time;
-uniform int numWaves;
-uniform float amplitude[8];
-uniform float wavelength[8];
-uniform float speed[8];
-uniform vec2 direction[8];
+//filled from the per-frame ring buffer, see WaveParams in WaterMesh.h
+layout (std140, binding = 1) uniform WaveParams
+{
+    vec4 waves[8];      //x amplitude, y wavelength, z speed
+    vec4 directions[8]; //xy direction
+    float time;
+    int numWaves;
+};
 uniform vec3 EyePos;
 
+#define amplitude(i) waves[i].x
+#define wavelength(i) waves[i].y
+#define speed(i) waves[i].z
+#define direction(i) directions[i].xy
+
 
 
 float wave(int i, float x, float y) {
-    float frequency = 2*pi/wavelength[i];
-    float phase = speed[i] * frequency;
-    float theta = dot(direction[i], vec2(x, y));
-    return amplitude[i] * sin(theta * frequency + time * phase);
+    float frequency = 2*pi/wavelength(i);
+    float phase = speed(i) * frequency;
+    float theta = dot(direction(i), vec2(x, y));
+    return amplitude(i) * sin(theta * frequency + time * phase);
 }
 
 float waveHeight(float x, float y) {
@@ -38,18 +53,18 @@ float waveHeight(float x, float y) {
 
 
 float dWavedx(int i, float x, float y) {
-    float frequency = 2*pi/wavelength[i];
-    float phase = speed[i] * frequency;
-    float theta = dot(direction[i], vec2(x, y));
-    float A = amplitude[i] * direction[i].x * frequency;
+    float frequency = 2*pi/wavelength(i);
+    float phase = speed(i) * frequency;
+    float theta = dot(direction(i), vec2(x, y));
+    float A = amplitude(i) * direction(i).x * frequency;
     return A * cos(theta * frequency + time * phase);
 }
 
 float dWavedy(int i, float x, float y) {
-    float frequency = 2*pi/wavelength[i];
-    float phase = speed[i] * frequency;
-    float theta = dot(direction[i], vec2(x, y));
-    float A = amplitude[i] * direction[i].y * frequency;
+    float frequency = 2*pi/wavelength(i);
+    float phase = speed(i) * frequency;
+    float theta = dot(direction(i), vec2(x, y));
+    float A = amplitude(i) * direction(i).y * frequency;
     return A * cos(theta * frequency + time * phase);
 }
 
@@ -71,9 +86,10 @@ void main()
 
     temp_pos = aPos;
     temp_pos.y = waveHeight(temp_pos.x,temp_pos.z);
-    FragPos = vec3(model * vec4(temp_pos, 1.0));
+    DrawTransform t = drawTransforms[drawIndex];
+    FragPos = vec3(t.model * vec4(temp_pos, 1.0));
     Normal = waveNormal(temp_pos.x,temp_pos.z);
-    Normal = mat3(transpose(inverse(model))) * Normal;
+    Normal = mat3(t.normal) * Normal;
 
-    gl_Position = projection * view * model * vec4(temp_pos, 1.0);
+    gl_Position = t.mvp * vec4(temp_pos, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,170 @@
+/************************************************************************
+	 File:        stats_reader.cpp
+
+	 Comment:
+						Entry point of WaterSurfaceStats.
+						Attaches read only to the stats block a running WaterSurface
+						publishes (LiveStats) and prints it, without slowing it down:
+						the block is a seqlock, a torn copy is simply read again.
+
+	 Usage:
+						WaterSurfaceStats [--watch ms] [--graph] [--name name]
+						--watch prints again every ms milliseconds until killed
+						--graph adds the frame time histogram as bars
+
+*************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "LiveStatsBlock.h"
+//only for the category names, nothing of them is linked
+#include "GlCallCounter.h"
+#include "GpuMemory.h"
+
+static const LiveStatsBlock* attach(const char* name) {
+#ifdef _WIN32
+	char mappingName[128];
+	snprintf(mappingName, sizeof(mappingName), "Local\\%s", name[0] == '/' ? name + 1 : name);
+	HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, mappingName);
+	if (!mapping)
+		return nullptr;
+	return (const LiveStatsBlock*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, sizeof(LiveStatsBlock));
+#else
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0)
+		return nullptr;
+	void* memory = mmap(nullptr, sizeof(LiveStatsBlock), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	return memory == MAP_FAILED ? nullptr : (const LiveStatsBlock*)memory;
+#endif
+}
+
+//a consistent copy of the data, false if the writer kept it busy
+static bool readData(const LiveStatsBlock* block, LiveStatsData& data) {
+	for (int attempt = 0; attempt < 1000; attempt++) {
+		uint32_t before = block->sequence.load(std::memory_order_acquire);
+		if (before & 1) {
+			std::this_thread::yield();
+			continue;
+		}
+		memcpy(&data, (const void*)&block->data, sizeof(LiveStatsData));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (block->sequence.load(std::memory_order_relaxed) == before)
+			return true;
+	}
+	return false;
+}
+
+static void print(const LiveStatsBlock* block, const LiveStatsData& data, bool graph) {
+	const double mb = 1024.0 * 1024.0;
+	printf("pid %d  frame %llu  %.2f ms (average %.2f, GPU %.2f)\n", block->pid,
+		(unsigned long long)data.frame, data.frameMs, data.averageFrameMs, data.gpuFrameMs);
+	if (data.loadTotal > 0 && strcmp(data.loadStage, "ready") != 0)
+		printf("loading %s %d/%d\n", data.loadStage, data.loadDone, data.loadTotal);
+
+	printf("stages ");
+	for (int i = 0; i < STAGE_COUNT; i++)
+		printf(" %s %.2f", frameStageNames[i], data.stageMs[i]);
+	printf(" ms\n");
+	if (data.gpuZoneCount > 0) {
+		printf("gpu    ");
+		for (uint32_t i = 0; i < data.gpuZoneCount && i < LIVE_STATS_GPU_ZONES; i++)
+			printf(" %*s%s %.2f", data.gpuZoneDepth[i] > 0 ? 1 : 0, "", data.gpuZoneNames[i], data.gpuZoneMs[i]);
+		printf(" ms\n");
+	}
+	printf("resolution %.0f%% (%.2f ms smoothed)\n", data.resolutionScale * 100.0f, data.resolutionFrameMs);
+
+	printf("queue   %u draws, %u program changes, %u material changes\n",
+		data.drawCount, data.programChanges, data.materialChanges);
+	printf("scene   %u nodes drawn, %u culled\n", data.sceneDrawn, data.sceneCulled);
+	printf("gl     ");
+	for (int i = 0; i < LIVE_STATS_GL_KINDS; i++)
+		printf(" %s %u", glCallKindNames[i], data.glCalls[i]);
+	printf("\n");
+
+	printf("gpu memory %.1f MB (peak %.1f), cpu framebuffer copies %.1f MB\n",
+		data.gpuMemoryTotal / mb, data.gpuMemoryPeak / mb, data.cpuFramebufferBytes / mb);
+	for (int i = 0; i < LIVE_STATS_MEMORY_CATEGORIES; i++)
+		printf("  %-14s %8.1f MB\n", gpuMemoryCategoryNames[i], data.gpuMemoryBytes[i] / mb);
+	printf("upload ring %.1f MB per frame, %u overflowed allocations\n",
+		data.uploadRingFrameBytes / mb, data.uploadRingOverflows);
+
+	if (!graph)
+		return;
+	uint32_t most = 1;
+	int first = LIVE_STATS_BUCKETS, last = 0;
+	for (int i = 0; i < LIVE_STATS_BUCKETS; i++) {
+		if (data.histogram[i] > most)
+			most = data.histogram[i];
+		if (data.histogram[i]) {
+			first = std::min(first, i);
+			last = i;
+		}
+	}
+	printf("frame time histogram\n");
+	for (int i = first; i <= last; i++) {
+		char bar[61];
+		int length = (int)(60.0 * data.histogram[i] / most);
+		memset(bar, '#', length);
+		bar[length] = 0;
+		printf("%s%2d ms %8u %s\n", i == LIVE_STATS_BUCKETS - 1 ? ">" : " ", i, data.histogram[i], bar);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const char* name = LIVE_STATS_NAME;
+	int watchMs = 0;
+	bool graph = false;
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "--watch") && hasValue)
+			watchMs = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--graph"))
+			graph = true;
+		else if (!strcmp(argv[i], "--name") && hasValue)
+			name = argv[++i];
+		else {
+			printf("usage: WaterSurfaceStats [--watch ms] [--graph] [--name name]\n");
+			return 1;
+		}
+	}
+
+	const LiveStatsBlock* block = attach(name);
+	if (!block) {
+		printf("WaterSurfaceStats: no stats at %s, is WaterSurface running?\n", name);
+		return 1;
+	}
+	if (block->magic != LIVE_STATS_MAGIC || block->version != LIVE_STATS_VERSION || block->size != sizeof(LiveStatsBlock)) {
+		printf("WaterSurfaceStats: %s is not a version %d stats block\n", name, LIVE_STATS_VERSION);
+		return 1;
+	}
+
+	do {
+		LiveStatsData data;
+		if (!readData(block, data)) {
+			printf("WaterSurfaceStats: no consistent copy, retrying\n");
+		}
+		else {
+			print(block, data, graph);
+			if (watchMs)
+				printf("\n");
+		}
+		if (watchMs)
+			std::this_thread::sleep_for(std::chrono::milliseconds(watchMs));
+	} while (watchMs);
+	return 0;
+}